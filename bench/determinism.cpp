@@ -0,0 +1,157 @@
+/**
+ *
+ * verification mode for the parallel layout: runs layout::layout and
+ * layout::parallel::layout side by side and reports the first node whose
+ * position differs in any bit.
+ *
+ * build: g++ -std=c++20 -O2 -I../src determinism.cpp -o determinism -pthread
+ * usage: ./determinism [root fanout, default 200000]
+ *
+ * trees:
+ *   wide      - the precision benchmark's wide root: mostly leaves, with an
+ *               occasional deep chain ending in a wide node.
+ *   category  - a flat category tree: a wide root over small random subtrees,
+ *               a few of them wide themselves.
+ *
+ * every tree is checked with double, float and 64-bit fixed-point nodes, in
+ * all orientations and radially, on 2, 4 and 8 threads. exits with 1 if any
+ * layout differs.
+ *
+ */
+
+#include "parallel_layout.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+template <typename T>
+struct BenchNode
+{
+    std::vector<BenchNode *> children;
+    BenchNode *parent = nullptr;
+    T x = 0, y = 0, w = 0, h = 0, prelim = 0, mod = 0, shift = 0, change = 0;
+    BenchNode *tl = nullptr, *tr = nullptr, *el = nullptr, *er = nullptr;
+    T msel = 0, mser = 0;
+};
+
+struct FixedNode
+{
+    static constexpr int fraction_bits = 8;
+    std::vector<FixedNode *> children;
+    FixedNode *parent = nullptr;
+    std::int64_t x = 0, y = 0, w = 0, h = 0, prelim = 0, mod = 0, shift = 0, change = 0;
+    FixedNode *tl = nullptr, *tr = nullptr, *el = nullptr, *er = nullptr;
+    std::int64_t msel = 0, mser = 0;
+};
+
+struct shape
+{
+    const char *name = "";
+    std::vector<int> parent{};
+    std::vector<double> w{}, h{};
+
+    int add(int p, double w_, double h_)
+    {
+        parent.push_back(p);
+        w.push_back(w_);
+        h.push_back(h_);
+        return int(parent.size()) - 1;
+    }
+};
+
+// same as bench/precision.cpp.
+shape make_wide(int fanout, unsigned seed)
+{
+    std::mt19937 g(seed);
+    shape s{"wide"};
+    s.add(-1, 50, 20);
+    for (int i = 0; i < fanout; ++i)
+    {
+        int p = 0;
+        int depth = g() % 10 == 0 ? 1 + g() % 5 : 0;
+        for (int d = 0; d <= depth; ++d)
+            p = s.add(p, d == depth && depth ? 40 + g() % 200 : 1 + (g() % 1000) / 100.0, 5 + (g() % 1000) / 100.0);
+    }
+    return s;
+}
+
+shape make_category(int fanout, unsigned seed)
+{
+    std::mt19937 g(seed);
+    shape s{"category"};
+    auto size = [&] { return 10 + (g() % 4000) / 100.0; };
+    s.add(-1, 50, 20);
+    for (int i = 0; i < fanout; ++i)
+    {
+        std::vector<int> sub{s.add(0, size(), size())};
+        int n = g() % 1000 == 0 ? 5000 : int(g() % 12);
+        for (int k = 0; k < n; ++k)
+            sub.push_back(s.add(n > 1000 ? sub[0] : sub[g() % sub.size()], size(), size()));
+    }
+    return s;
+}
+
+template <typename Node>
+std::vector<std::unique_ptr<Node>> build(const shape &s, double scale)
+{
+    std::vector<std::unique_ptr<Node>> nodes;
+    nodes.reserve(s.parent.size());
+    for (std::size_t i = 0; i < s.parent.size(); ++i)
+    {
+        auto n = std::make_unique<Node>();
+        n->w = decltype(n->w)(s.w[i] * scale);
+        n->h = decltype(n->h)(s.h[i] * scale);
+        if (s.parent[i] >= 0)
+        {
+            n->parent = nodes[s.parent[i]].get();
+            n->parent->children.push_back(n.get());
+        }
+        nodes.push_back(std::move(n));
+    }
+    return nodes;
+}
+
+template <typename Node>
+bool check(const char *type, const shape &s, double scale)
+{
+    static const char *names[] = {"top_down", "bottom_up", "left_right", "right_left", "radial"};
+    bool ok = true;
+    auto nodes = build<Node>(s, scale);
+    for (int o = 0; o < 5; ++o)
+    {
+        layout::options opt;
+        if (o < 4)
+            opt.orientation = layout::orientation(o);
+        else
+            opt.radial = true;
+        for (unsigned threads : {2u, 4u, 8u})
+        {
+            auto m = layout::parallel::verify(nodes[0].get(), opt, threads);
+            if (!m.node)
+                continue;
+            ok = false;
+            std::printf("%-9s %-7s %-10s %u threads: node %zu differs, serial (%.17g, %.17g) parallel (%.17g, %.17g)\n",
+                        s.name, type, names[o], threads, m.index,
+                        double(m.serial_x), double(m.serial_y), double(m.parallel_x), double(m.parallel_y));
+        }
+    }
+    if (ok)
+        std::printf("%-9s %-7s identical (%zu nodes)\n", s.name, type, nodes.size());
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    int fanout = argc > 1 ? std::atoi(argv[1]) : 200000;
+    bool ok = true;
+    for (const shape &s : {make_wide(fanout, 1), make_category(fanout, 2)})
+    {
+        ok &= check<BenchNode<double>>("double", s, 1);
+        ok &= check<BenchNode<float>>("float", s, 1);
+        ok &= check<FixedNode>("fixed", s, 256);
+    }
+    return ok ? 0 : 1;
+}
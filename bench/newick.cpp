@@ -0,0 +1,140 @@
+/**
+ *
+ * Newick reading speed next to layout speed.
+ *
+ * build: g++ -std=c++20 -O2 -I../src newick.cpp -o newick -pthread
+ * usage: ./newick [file.nwk]
+ *        ./newick [leaves per tree, default 2000000] [trees, default 1]
+ *
+ * without a file, random binary phylogenies are generated in memory, with
+ * labels like Taxon_123456 and six-digit branch lengths.
+ *
+ * reports the parse rate (best of three, node memory already allocated),
+ * the layout time of all trees, and newick::pipeline() doing both.
+ *
+ */
+
+#include "newick.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+
+double since(clock_type::time_point t)
+{
+    return std::chrono::duration<double, std::milli>(clock_type::now() - t).count();
+}
+
+// splits `leaves` at random until single leaves remain.
+void phylogeny(std::string &out, int leaves, std::mt19937 &g)
+{
+    struct part
+    {
+        int leaves, right, state; // state 0: not started, 1: left written, 2: right written
+    };
+    std::vector<part> stack{{leaves, 0, 0}};
+    char buf[64];
+    while (!stack.empty())
+    {
+        part &p = stack.back();
+        if (p.state == 0 && p.leaves == 1)
+        {
+            out.append(buf, std::size_t(std::snprintf(buf, sizeof buf, "Taxon_%u:%.6f", unsigned(g() % 1000000), (g() % 100000) / 1e5)));
+            stack.pop_back();
+        }
+        else if (p.state == 0)
+        {
+            int left = 1 + int(g() % unsigned(p.leaves - 1));
+            out += '(';
+            p.right = p.leaves - left;
+            p.state = 1;
+            stack.push_back({left, 0, 0});
+        }
+        else if (p.state == 1)
+        {
+            out += ',';
+            p.state = 2;
+            stack.push_back({p.right, 0, 0});
+        }
+        else
+        {
+            out.append(buf, std::size_t(std::snprintf(buf, sizeof buf, ")%u:%.6f", unsigned(g() % 100), (g() % 100000) / 1e5)));
+            stack.pop_back();
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::string generated;
+    std::string_view text;
+    std::optional<layout::mapped_file> file;
+    if (argc > 1 && !std::isdigit(static_cast<unsigned char>(argv[1][0])))
+    {
+        file.emplace(argv[1]);
+        if (!file->ok())
+        {
+            std::perror(argv[1]);
+            return 1;
+        }
+        text = file->text();
+    }
+    else
+    {
+        int leaves = argc > 1 ? std::atoi(argv[1]) : 2000000;
+        int trees = argc > 2 ? std::atoi(argv[2]) : 1;
+        std::mt19937 g(1);
+        for (int k = 0; k < trees; ++k)
+        {
+            phylogeny(generated, std::max(leaves, 1), g);
+            generated += ";\n";
+        }
+        text = generated;
+    }
+
+    layout::newick::tree<> t;
+    std::size_t nodes = 0, trees = 0;
+    double best = 1e300;
+    for (int rep = 0; rep < 3; ++rep)
+    {
+        auto start = clock_type::now();
+        layout::newick::reader r(text);
+        nodes = trees = 0;
+        while (r.next(t))
+        {
+            nodes += t.size();
+            ++trees;
+        }
+        best = std::min(best, since(start));
+        if (r.failed())
+        {
+            std::printf("not Newick at byte %zu\n", r.offset());
+            return 1;
+        }
+    }
+    std::printf("%zu MB, %zu trees, %zu nodes\n", text.size() >> 20, trees, nodes);
+    std::printf("parse    %8.1f ms  %6.0f MB/s  %5.1f ns/node\n", best, text.size() / best / 1e3, best * 1e6 / double(nodes));
+
+    auto start = clock_type::now();
+    double laid = 0;
+    layout::newick::reader r(text);
+    while (r.next(t))
+    {
+        auto s = clock_type::now();
+        layout::layout(t.root());
+        laid += since(s);
+    }
+    std::printf("layout   %8.1f ms  %19.1f ns/node\n", laid, laid * 1e6 / double(nodes));
+    std::printf("both     %8.1f ms\n", since(start));
+
+    start = clock_type::now();
+    layout::newick::pipeline(text, {}, [](layout::newick::tree<> &) {});
+    std::printf("pipeline %8.1f ms\n", since(start));
+}
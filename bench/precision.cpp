@@ -0,0 +1,141 @@
+/**
+ *
+ * memory/accuracy trade-off of float node storage on very wide trees.
+ *
+ * build: g++ -std=c++20 -O2 -I../src precision.cpp -o precision
+ * usage: ./precision [root fanout, default 1000000]
+ *
+ * compares three storage modes against a double reference:
+ *   double       - reference.
+ *   float        - mixed precision (float fields, double/compensated sums).
+ *   float/naive  - float fields where every intermediate mod is rounded to float,
+ *                  which is what float nodes did before mixed precision.
+ *
+ */
+
+#include "layout.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+// float that rounds on every store but has no floating point identity,
+// so the layout takes the plain (non mixed precision) path.
+struct narrow
+{
+    float v = 0;
+    narrow() = default;
+    narrow(double d) : v(float(d)) {}
+    operator double() const { return v; }
+    narrow &operator+=(double d) { v = float(v + d); return *this; }
+    narrow &operator-=(double d) { v = float(v - d); return *this; }
+};
+
+template <typename T>
+struct BenchNode
+{
+    std::vector<BenchNode *> children;
+    BenchNode *parent = nullptr;
+    T x = 0, y = 0, w = 0, h = 0, prelim = 0, mod = 0, shift = 0, change = 0;
+    BenchNode *tl = nullptr, *tr = nullptr, *el = nullptr, *er = nullptr;
+    T msel = 0, mser = 0;
+};
+
+struct shape
+{
+    std::vector<int> parent;
+    std::vector<double> w, h;
+};
+
+// a wide root whose children are mostly leaves with an occasional deep
+// chain ending in a wide node, so distribute_extra spreads many siblings.
+shape make_wide(int fanout, unsigned seed)
+{
+    std::mt19937 g(seed);
+    shape s;
+    s.parent.push_back(-1);
+    s.w.push_back(50);
+    s.h.push_back(20);
+    for (int i = 0; i < fanout; ++i)
+    {
+        int p = 0;
+        int depth = g() % 10 == 0 ? 1 + g() % 5 : 0;
+        for (int d = 0; d <= depth; ++d)
+        {
+            s.parent.push_back(p);
+            s.w.push_back(d == depth && depth ? 40 + g() % 200 : 1 + (g() % 1000) / 100.0);
+            s.h.push_back(5 + (g() % 1000) / 100.0);
+            p = int(s.parent.size()) - 1;
+        }
+    }
+    return s;
+}
+
+template <typename T>
+std::vector<std::unique_ptr<BenchNode<T>>> build(const shape &s)
+{
+    std::vector<std::unique_ptr<BenchNode<T>>> nodes;
+    nodes.reserve(s.parent.size());
+    for (std::size_t i = 0; i < s.parent.size(); ++i)
+    {
+        auto n = std::make_unique<BenchNode<T>>();
+        n->w = s.w[i];
+        n->h = s.h[i];
+        if (s.parent[i] >= 0)
+        {
+            n->parent = nodes[s.parent[i]].get();
+            n->parent->children.push_back(n.get());
+        }
+        nodes.push_back(std::move(n));
+    }
+    return nodes;
+}
+
+template <typename T>
+void run(const char *name, const shape &s, const std::vector<std::unique_ptr<BenchNode<double>>> &ref)
+{
+    auto nodes = build<T>(s);
+    auto t0 = std::chrono::steady_clock::now();
+    layout::layout(nodes[0].get());
+    auto t1 = std::chrono::steady_clock::now();
+
+    // absolute drift against double, and the worst spacing error between
+    // adjacent siblings (what actually shows up on screen).
+    double maxerr = 0, sumerr = 0, gaperr = 0;
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+        double e = std::fabs(double(nodes[i]->x) - ref[i]->x);
+        maxerr = std::max(maxerr, e);
+        sumerr += e;
+        auto &ch = nodes[i]->children;
+        auto &rch = ref[i]->children;
+        for (std::size_t k = 1; k < ch.size(); ++k)
+        {
+            double gap = double(ch[k]->x) - double(ch[k - 1]->x);
+            double rgap = rch[k]->x - rch[k - 1]->x;
+            gaperr = std::max(gaperr, std::fabs(gap - rgap));
+        }
+    }
+    std::printf("%-12s %4zu bytes/node  %8.1f ms  max drift %-10g mean drift %-10g max gap err %g\n",
+                name, sizeof(BenchNode<T>),
+                std::chrono::duration<double, std::milli>(t1 - t0).count(),
+                maxerr, sumerr / nodes.size(), gaperr);
+}
+
+int main(int argc, char **argv)
+{
+    int fanout = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    shape s = make_wide(fanout, 42);
+    std::printf("%zu nodes, root fanout %d\n", s.parent.size(), fanout);
+
+    auto ref = build<double>(s);
+    layout::layout(ref[0].get());
+
+    run<double>("double", s, ref);
+    run<float>("float", s, ref);
+    run<narrow>("float/naive", s, ref);
+    return 0;
+}
@@ -0,0 +1,406 @@
+/**
+ *
+ * local layout service: lays out trees sent over a Unix domain socket, so
+ * processes on one machine can share one set of worker threads and one
+ * result cache instead of each embedding the layout.
+ *
+ * build: g++ -std=c++20 -O2 -I../src layout_server.cpp -o layout_server -pthread
+ * usage: ./layout_server [socket path, default /tmp/tidy_tree.sock]
+ *                        [workers, default one per hardware thread]
+ *                        [cache size in MB, default 256]
+ *
+ * protocol and client: src/service.hpp.
+ *
+ *   - every connection gets a thread that reads requests and answers them
+ *     in order.
+ *   - answers are cached by the request bytes (sizes, shape and options)
+ *     and their hash, least recently used first out. a cached answer is
+ *     sent without touching the workers.
+ *   - other requests go to a shared queue. a worker takes a batch of
+ *     queued requests at once, up to batch_nodes nodes in total and its
+ *     share of the queue, so many small trees cost one wake-up instead of
+ *     one each while the other workers still get some. a worker that
+ *     leaves jobs behind wakes the next one. every worker lays
+ *     out into its own node storage, reused from one request to the next.
+ *     a request that cannot be laid out, including one that runs out of
+ *     memory, is answered with bad_request; it never stops a worker.
+ *
+ * trees are laid out with layout::basic_node<double>.
+ *
+ */
+
+#include "layout.hpp"
+#include "basic_node.hpp"
+#include "service.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace service = layout::service;
+using node = layout::basic_node<double>;
+
+constexpr std::uint32_t max_nodes = 1u << 26;
+constexpr std::size_t batch_nodes = 1 << 16;
+constexpr std::size_t batch_jobs = 256;
+constexpr std::size_t read_chunk = 1 << 20;
+
+// FNV-1a, 64 bit.
+std::uint64_t hash(const std::vector<char> &bytes)
+{
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    for (char c : bytes)
+    {
+        h ^= std::uint8_t(c);
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+// answers by request, least recently used evicted first. entries are
+// indexed by hash and request bytes, so requests whose hashes collide are
+// kept side by side.
+class result_cache
+{
+public:
+    explicit result_cache(std::size_t limit) : limit_(limit) {}
+
+    bool find(std::uint64_t h, const std::vector<char> &request, std::vector<char> &response)
+    {
+        std::lock_guard lock(m_);
+        auto it = index_.find({h, &request});
+        if (it == index_.end())
+            return false;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        response = it->second->response;
+        return true;
+    }
+
+    void insert(std::uint64_t h, const std::vector<char> &request, const std::vector<char> &response)
+    {
+        std::size_t size = request.size() + response.size();
+        if (size > limit_)
+            return;
+        std::lock_guard lock(m_);
+        if (auto it = index_.find({h, &request}); it != index_.end())
+        {
+            auto old = it->second;
+            index_.erase(it);
+            bytes_ -= old->request.size() + old->response.size();
+            lru_.erase(old);
+        }
+        lru_.push_front({h, request, response});
+        index_[{h, &lru_.front().request}] = lru_.begin();
+        bytes_ += size;
+        while (bytes_ > limit_)
+        {
+            entry &e = lru_.back();
+            bytes_ -= e.request.size() + e.response.size();
+            index_.erase({e.hash, &e.request});
+            lru_.pop_back();
+        }
+    }
+
+private:
+    struct entry
+    {
+        std::uint64_t hash;
+        std::vector<char> request, response;
+    };
+
+    // points at the request held by the entry (or the caller's, to look
+    // one up).
+    struct key
+    {
+        std::uint64_t hash;
+        const std::vector<char> *request;
+    };
+
+    struct key_hash
+    {
+        std::size_t operator()(const key &k) const { return std::size_t(k.hash); }
+    };
+
+    struct key_equal
+    {
+        bool operator()(const key &a, const key &b) const { return a.hash == b.hash && *a.request == *b.request; }
+    };
+
+    std::mutex m_;
+    std::list<entry> lru_;
+    std::unordered_map<key, std::list<entry>::iterator, key_hash, key_equal> index_;
+    std::size_t bytes_ = 0, limit_;
+};
+
+struct job
+{
+    std::vector<char> request; // header and records
+    std::uint64_t hash;
+    std::promise<std::vector<char>> response;
+};
+
+class job_queue
+{
+public:
+    explicit job_queue(unsigned workers) : workers_(workers) {}
+
+    void push(job *j)
+    {
+        {
+            std::lock_guard lock(m_);
+            jobs_.push_back(j);
+        }
+        cv_.notify_one();
+    }
+
+    // wait for work, then take queued jobs up to batch_nodes nodes (at
+    // least one), batch_jobs jobs and one worker's share of the queue.
+    void pop_batch(std::vector<job *> &out)
+    {
+        out.clear();
+        std::unique_lock lock(m_);
+        cv_.wait(lock, [&] { return !jobs_.empty(); });
+        std::size_t share = (jobs_.size() + workers_ - 1) / workers_;
+        std::size_t nodes = 0;
+        while (!jobs_.empty() && out.size() < batch_jobs && out.size() < share)
+        {
+            std::size_t n = count(jobs_.front());
+            if (!out.empty() && nodes + n > batch_nodes)
+                break;
+            out.push_back(jobs_.front());
+            jobs_.pop_front();
+            nodes += n;
+        }
+        bool more = !jobs_.empty();
+        lock.unlock();
+        if (more)
+            cv_.notify_one();
+    }
+
+private:
+    static std::size_t count(const job *j)
+    {
+        service::request_header h;
+        std::memcpy(&h, j->request.data(), sizeof h);
+        return h.count;
+    }
+
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::deque<job *> jobs_;
+    std::size_t workers_;
+};
+
+std::vector<char> refuse()
+{
+    std::vector<char> out(sizeof(service::response_header));
+    service::response_header r;
+    r.result = service::status::bad_request;
+    std::memcpy(out.data(), &r, sizeof r);
+    return out;
+}
+
+// lay out the request of j and answer it. false if it cannot be laid out.
+bool answer(job *j, std::vector<node> &nodes, result_cache &cache)
+{
+    service::request_header h;
+    std::memcpy(&h, j->request.data(), sizeof h);
+    auto *records = reinterpret_cast<const service::node_record *>(j->request.data() + sizeof h);
+
+    layout::options opt;
+    node *root = service::decode(h, records, nodes, opt);
+    if (!root)
+        return false;
+    layout::layout(root, opt);
+
+    std::vector<char> out(sizeof(service::response_header) + h.count * sizeof(service::position));
+    service::response_header r;
+    r.count = h.count;
+    std::memcpy(out.data(), &r, sizeof r);
+    auto *pos = reinterpret_cast<service::position *>(out.data() + sizeof r);
+    for (std::uint32_t i = 0; i < h.count; ++i)
+        pos[i] = {nodes[i].x, nodes[i].y};
+
+    cache.insert(j->hash, j->request, out);
+    j->response.set_value(std::move(out));
+    return true;
+}
+
+void work(job_queue &queue, result_cache &cache)
+{
+    std::vector<node> nodes; // this worker's workspace
+    std::vector<job *> batch;
+    for (;;)
+    {
+        queue.pop_batch(batch);
+        for (job *j : batch)
+        {
+            // an exception here would end the detached thread, and with it
+            // the process; the client waiting on j must get an answer.
+            bool done = false;
+            try
+            {
+                done = answer(j, nodes, cache);
+            }
+            catch (...)
+            {
+                nodes = {}; // it may be what ran out of memory
+            }
+            if (!done)
+                j->response.set_value(refuse());
+        }
+    }
+}
+
+// the records of a request after its header h, into request. memory grows
+// with the bytes that actually arrive, read_chunk at a time, so a header
+// that promises max_nodes costs nothing until the records come.
+bool receive(int fd, const service::request_header &h, std::vector<char> &request)
+{
+    request.resize(sizeof h);
+    std::memcpy(request.data(), &h, sizeof h);
+    std::size_t left = std::size_t(h.count) * sizeof(service::node_record);
+    while (left > 0)
+    {
+        std::size_t k = left < read_chunk ? left : read_chunk, at = request.size();
+        request.resize(at + k);
+        if (!service::details::recv_all(fd, request.data() + at, k))
+            return false;
+        left -= k;
+    }
+    return true;
+}
+
+void serve(int fd, job_queue &queue, result_cache &cache)
+{
+    for (;;)
+    {
+        service::request_header h;
+        if (!service::details::recv_all(fd, &h, sizeof h))
+            break;
+        if (h.magic != service::request_magic || h.version != service::version || h.count > max_nodes)
+        {
+            // the stream cannot be followed any further.
+            std::vector<char> no = refuse();
+            service::details::send_all(fd, no.data(), no.size());
+            break;
+        }
+        job j;
+        if (!receive(fd, h, j.request))
+            break;
+        j.hash = hash(j.request);
+
+        std::vector<char> response;
+        if (!cache.find(j.hash, j.request, response))
+        {
+            std::future<std::vector<char>> done = j.response.get_future();
+            queue.push(&j);
+            response = done.get();
+        }
+        if (!service::details::send_all(fd, response.data(), response.size()))
+            break;
+    }
+    close(fd);
+}
+
+// make room for a new socket at addr: fine if nothing is there, and a
+// socket nobody listens on any more (left by a server that died) is
+// removed. false, with a message, if a server answers there or the path
+// is something else.
+bool free_path(const sockaddr_un &addr)
+{
+    const char *path = addr.sun_path;
+    struct stat st;
+    if (lstat(path, &st) != 0)
+    {
+        if (errno == ENOENT)
+            return true;
+        std::perror(path);
+        return false;
+    }
+    if (!S_ISSOCK(st.st_mode))
+    {
+        std::fprintf(stderr, "%s exists and is not a socket\n", path);
+        return false;
+    }
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0)
+    {
+        std::perror("socket");
+        return false;
+    }
+    bool live = connect(probe, reinterpret_cast<const sockaddr *>(&addr), sizeof addr) == 0;
+    int err = errno;
+    close(probe);
+    if (live)
+    {
+        std::fprintf(stderr, "a server is already listening on %s\n", path);
+        return false;
+    }
+    if (err != ECONNREFUSED)
+    {
+        std::fprintf(stderr, "%s: %s\n", path, std::strerror(err));
+        return false;
+    }
+    if (unlink(path) != 0)
+    {
+        std::perror(path);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : "/tmp/tidy_tree.sock";
+    unsigned workers = argc > 2 ? unsigned(std::atoi(argv[2])) : std::thread::hardware_concurrency();
+    std::size_t cache_mb = argc > 3 ? std::size_t(std::atoll(argv[3])) : 256;
+    if (workers == 0)
+        workers = 1;
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof addr.sun_path)
+    {
+        std::fprintf(stderr, "socket path too long: %s\n", path);
+        return 1;
+    }
+    std::strcpy(addr.sun_path, path);
+    if (!free_path(addr))
+        return 1;
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0 || listen(listener, 64) != 0)
+    {
+        std::perror(path);
+        return 1;
+    }
+
+    job_queue queue(workers);
+    result_cache cache(cache_mb << 20);
+    for (unsigned k = 0; k < workers; ++k)
+        std::thread(work, std::ref(queue), std::ref(cache)).detach();
+    std::printf("listening on %s, %u workers, %zu MB cache\n", path, workers, cache_mb);
+    std::fflush(stdout);
+
+    for (;;)
+    {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        std::thread(serve, fd, std::ref(queue), std::ref(cache)).detach();
+    }
+}
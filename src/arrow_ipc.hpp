@@ -0,0 +1,495 @@
+/**
+ *
+ * layout results as Apache Arrow columns, in the IPC stream or file format
+ * (the file format is what .arrow / Feather v2 readers open), written
+ * without the Arrow library:
+ *
+ *   id      uint32   preorder id (the ids of metrics.hpp), the root is 0
+ *   parent  uint32   id of the parent, null for the root
+ *   depth   uint32
+ *   x, y    float64  top-left corner, in drawing units
+ *   w, h    float64
+ *
+ *   layout::layout(root);
+ *   std::FILE *f = std::fopen("tree.arrow", "wb");
+ *   layout::arrow::write(root, layout::file_sink{f}, {.file = true});
+ *
+ *   pyarrow.ipc.open_file("tree.arrow").read_all()
+ *
+ * a succinct tree (succinct_layout.hpp) is written the same way from its
+ * coords, which are already columns: write(tree, coords, sink).
+ *
+ * rows go out in record batches of format::batch_rows. one preorder walk,
+ * paused between batches, gathers each batch straight into its column
+ * buffers, in the byte layout of the message body, which goes to the sink
+ * as one piece: no row objects, no id table, and memory for one batch. the
+ * message headers are flatbuffers, built by the small builder below.
+ *
+ * little-endian hosts only, like the format's default.
+ *
+ */
+
+#pragma once
+#include "layout.hpp"
+#include "succinct_layout.hpp"
+#include "text_output.hpp"
+#include <vector>
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+namespace layout
+{
+    namespace arrow
+    {
+        static_assert(std::endian::native == std::endian::little, "Arrow IPC output is written little-endian");
+
+        struct format
+        {
+            std::size_t batch_rows = std::size_t(1) << 16; // rows per record batch
+            bool file = false;                              // the IPC file format rather than a stream
+        };
+
+        namespace details
+        {
+            using namespace layout::details;
+
+            // —————————————————————————————————————————————————————
+            // a flatbuffer written back to front, as flatbuffers are: children
+            // before their parents, so every offset points forward. positions
+            // are counted from the end until finish(), and the end is kept
+            // 8-aligned, so alignment from the end is alignment in the file.
+            class builder
+            {
+            public:
+                std::uint32_t size() const { return std::uint32_t(buf_.size() - head_); }
+                const std::uint8_t *data() const { return buf_.data() + head_; }
+
+                // pad so that `bytes` more leave the size a multiple of `alignment`.
+                void align(std::size_t bytes, std::size_t alignment)
+                {
+                    while ((size() + bytes) % alignment)
+                        raw<std::uint8_t>(0);
+                }
+
+                template <typename T>
+                std::uint32_t scalar(T v)
+                {
+                    align(0, sizeof(T));
+                    raw(v);
+                    return size();
+                }
+
+                std::uint32_t offset(std::uint32_t target)
+                {
+                    align(0, 4);
+                    raw<std::uint32_t>(size() + 4 - target);
+                    return size();
+                }
+
+                std::uint32_t string(std::string_view s)
+                {
+                    align(s.size() + 1, 4);
+                    raw<std::uint8_t>(0);
+                    bytes(s.data(), s.size());
+                    raw<std::uint32_t>(std::uint32_t(s.size()));
+                    return size();
+                }
+
+                // a vector of tables.
+                std::uint32_t offsets(const std::vector<std::uint32_t> &v)
+                {
+                    align(v.size() * 4, 4);
+                    for (std::size_t k = v.size(); k-- > 0;)
+                        offset(v[k]);
+                    raw<std::uint32_t>(std::uint32_t(v.size()));
+                    return size();
+                }
+
+                // a vector of structs of 8-byte alignment.
+                template <typename T>
+                std::uint32_t structs(const std::vector<T> &v)
+                {
+                    align(v.size() * sizeof(T), 8);
+                    bytes(v.data(), v.size() * sizeof(T));
+                    raw<std::uint32_t>(std::uint32_t(v.size()));
+                    return size();
+                }
+
+                void start()
+                {
+                    fields_.clear();
+                    table_ = size();
+                }
+
+                template <typename T>
+                void add(std::uint16_t id, T v) { fields_.push_back({id, scalar(v)}); }
+
+                void add_offset(std::uint16_t id, std::uint32_t target) { fields_.push_back({id, offset(target)}); }
+
+                // the table, with its vtable in front of it.
+                std::uint32_t end()
+                {
+                    std::uint32_t table = scalar<std::int32_t>(0);
+                    std::uint16_t count = 0;
+                    for (const field &f : fields_)
+                        count = std::max<std::uint16_t>(count, f.id + 1);
+                    std::vector<std::uint16_t> vt(2 + count, 0);
+                    vt[0] = std::uint16_t(2 * vt.size());
+                    vt[1] = std::uint16_t(table - table_);
+                    for (const field &f : fields_)
+                        vt[2 + f.id] = std::uint16_t(table - f.at);
+                    align(0, 2);
+                    for (std::size_t k = vt.size(); k-- > 0;)
+                        raw(vt[k]);
+                    std::int32_t to_vtable = std::int32_t(size() - table);
+                    std::memcpy(buf_.data() + buf_.size() - table, &to_vtable, 4);
+                    return table;
+                }
+
+                void finish(std::uint32_t root)
+                {
+                    align(4, 8);
+                    offset(root);
+                }
+
+            private:
+                struct field
+                {
+                    std::uint16_t id;
+                    std::uint32_t at;
+                };
+
+                template <typename T>
+                void raw(T v) { bytes(&v, sizeof(T)); }
+
+                void bytes(const void *p, std::size_t n)
+                {
+                    if (head_ < n)
+                    {
+                        std::size_t used = size(), cap = std::max<std::size_t>(2 * buf_.size(), used + n + 256);
+                        std::vector<std::uint8_t> b(cap);
+                        std::memcpy(b.data() + cap - used, data(), used);
+                        buf_.swap(b);
+                        head_ = cap - used;
+                    }
+                    head_ -= n;
+                    std::memcpy(buf_.data() + head_, p, n);
+                }
+
+                std::vector<std::uint8_t> buf_;
+                std::size_t head_ = 0;
+                std::uint32_t table_ = 0;
+                std::vector<field> fields_;
+            };
+
+            // —————————————————————————————————————————————————————
+            // the parts of Schema.fbs and Message.fbs used here.
+            inline constexpr std::int16_t metadata_v5 = 4;
+            inline constexpr std::uint8_t header_schema = 1, header_record_batch = 3;
+            inline constexpr std::uint8_t type_int = 2, type_floating_point = 3;
+            inline constexpr std::int16_t precision_double = 2;
+
+            struct column
+            {
+                std::string_view name;
+                std::size_t width; // bytes per value
+                bool nullable;
+            };
+
+            inline constexpr column columns[] = {{"id", 4, false}, {"parent", 4, true}, {"depth", 4, false},
+                                                 {"x", 8, false}, {"y", 8, false}, {"w", 8, false}, {"h", 8, false}};
+
+            struct field_node
+            {
+                std::int64_t length, null_count;
+            };
+
+            struct buffer
+            {
+                std::int64_t offset, length;
+            };
+
+            struct block
+            {
+                std::int64_t offset;
+                std::int32_t metadata_length, pad;
+                std::int64_t body_length;
+            };
+
+            inline std::uint32_t schema(builder &b)
+            {
+                std::vector<std::uint32_t> fields;
+                for (const column &c : columns)
+                {
+                    std::uint32_t children = b.offsets({});
+                    b.start();
+                    if (c.width == 4)
+                    {
+                        b.add<std::int32_t>(0, 32); // bitWidth
+                        b.add<std::uint8_t>(1, 0);  // is_signed
+                    }
+                    else
+                        b.add(0, precision_double);
+                    std::uint32_t type = b.end();
+                    std::uint32_t name = b.string(c.name);
+                    b.start();
+                    b.add_offset(0, name);
+                    b.add<std::uint8_t>(1, c.nullable);
+                    b.add(2, c.width == 4 ? type_int : type_floating_point);
+                    b.add_offset(3, type);
+                    b.add_offset(5, children);
+                    fields.push_back(b.end());
+                }
+                std::uint32_t list = b.offsets(fields);
+                b.start();
+                b.add_offset(1, list);
+                return b.end();
+            }
+
+            inline std::size_t padded(std::size_t n) { return (n + 7) & ~std::size_t(7); }
+
+            // where each buffer of a batch of `rows` goes in its body; the
+            // parent column has a validity bitmap only if the root is in it.
+            inline std::vector<buffer> body_layout(std::size_t rows, bool root)
+            {
+                std::vector<buffer> out;
+                std::int64_t at = 0;
+                for (const column &c : columns)
+                {
+                    std::int64_t bitmap = c.nullable && root ? std::int64_t((rows + 7) / 8) : 0;
+                    out.push_back({at, bitmap});
+                    at += std::int64_t(padded(std::size_t(bitmap)));
+                    out.push_back({at, std::int64_t(rows * c.width)});
+                    at += std::int64_t(padded(rows * c.width));
+                }
+                return out;
+            }
+
+            // the values of column k in a body laid out as `at`.
+            template <typename T>
+            T *values(std::byte *body, const std::vector<buffer> &at, std::size_t k)
+            {
+                return reinterpret_cast<T *>(body + at[2 * k + 1].offset);
+            }
+
+            // continuation marker, metadata length, the flatbuffer padded to
+            // 8 bytes; returns the bytes written.
+            template <typename Out>
+            std::size_t message(Out &out, builder &b, std::uint8_t type, std::uint32_t header, std::int64_t body)
+            {
+                b.start();
+                b.add(0, metadata_v5);
+                b.add(1, type);
+                b.add_offset(2, header);
+                b.add(3, body);
+                b.finish(b.end());
+                std::size_t size = padded(b.size());
+                std::uint32_t prefix[2] = {0xFFFFFFFF, std::uint32_t(size)};
+                static constexpr char zeros[8] = {};
+                out(reinterpret_cast<const char *>(prefix), 8);
+                out(reinterpret_cast<const char *>(b.data()), b.size());
+                out(zeros, size - b.size());
+                return 8 + size;
+            }
+
+            // a preorder walk of a node tree, one row at a time, picked up
+            // again for every batch.
+            template <TreeNode Node>
+            class node_rows
+            {
+            public:
+                explicit node_rows(Node *t) : next_(t) {}
+
+                bool done() const { return next_ == nullptr; }
+
+                void row(std::uint32_t &id, std::uint32_t &parent, std::uint32_t &depth, double &x, double &y, double &w, double &h)
+                {
+                    Node *c = next_;
+                    id = id_;
+                    parent = stack_.empty() ? 0 : stack_.back().id;
+                    depth = std::uint32_t(stack_.size());
+                    x = units<Node>(c->x);
+                    y = units<Node>(c->y);
+                    w = units<Node>(c->w);
+                    h = units<Node>(c->h);
+                    stack_.push_back({c, 0, id_++});
+                    next_ = nullptr;
+                    while (!stack_.empty())
+                    {
+                        frame &top = stack_.back();
+                        if (top.next < top.n->children.size())
+                        {
+                            next_ = top.n->children[top.next++];
+                            break;
+                        }
+                        stack_.pop_back();
+                    }
+                }
+
+            private:
+                struct frame
+                {
+                    Node *n;
+                    std::size_t next; // child to visit next
+                    std::uint32_t id;
+                };
+                std::vector<frame> stack_;
+                Node *next_;
+                std::uint32_t id_ = 0;
+            };
+
+            // the same rows from a succinct tree: one pass over its
+            // parentheses, ids being positions in coords.
+            class succinct_rows
+            {
+            public:
+                succinct_rows(const succinct::tree &t, const succinct::coords &c) : t_(t), c_(c) { skip(); }
+
+                bool done() const { return v_ == t_.size(); }
+
+                void row(std::uint32_t &id, std::uint32_t &parent, std::uint32_t &depth, double &x, double &y, double &w, double &h)
+                {
+                    id = v_;
+                    parent = open_.empty() ? 0 : open_.back();
+                    depth = std::uint32_t(open_.size());
+                    x = c_.x[v_];
+                    y = c_.y[v_];
+                    w = t_.w[v_];
+                    h = t_.h[v_];
+                    open_.push_back(v_++);
+                    ++p_;
+                    skip();
+                }
+
+            private:
+                // past the ')' before the next node's '('.
+                void skip()
+                {
+                    for (; p_ < t_.bp.size() && !t_.bp.get(p_); ++p_)
+                        open_.pop_back();
+                }
+
+                const succinct::tree &t_;
+                const succinct::coords &c_;
+                std::vector<std::uint32_t> open_; // ids of the open nodes, root first
+                std::size_t p_ = 0;
+                std::uint32_t v_ = 0;
+            };
+
+            // the stream or file for the rows of `rows`.
+            template <typename Rows, TextSink Out>
+            void write(Rows &rows_in, Out &out, const format &f)
+            {
+                std::size_t written = 0;
+                auto put = [&](const char *p, std::size_t k)
+                {
+                    out(p, k);
+                    written += k;
+                };
+                if (f.file)
+                    put("ARROW1\0\0", 8);
+
+                {
+                    builder b;
+                    message(put, b, header_schema, schema(b), 0);
+                }
+
+                std::size_t capacity = std::max<std::size_t>(f.batch_rows, 1);
+                std::vector<buffer> full = body_layout(capacity, true);
+                std::unique_ptr<std::byte[]> body(new std::byte[std::size_t(full.back().offset + full.back().length) + 8]);
+                std::vector<block> blocks;
+                for (bool root = true; !rows_in.done(); root = false)
+                {
+                    // gather into columns spaced for a full batch.
+                    full = body_layout(capacity, root);
+                    std::byte *data = body.get();
+                    auto *ids = values<std::uint32_t>(data, full, 0), *parent = values<std::uint32_t>(data, full, 1),
+                         *depth = values<std::uint32_t>(data, full, 2);
+                    auto *x = values<double>(data, full, 3), *y = values<double>(data, full, 4),
+                         *w = values<double>(data, full, 5), *h = values<double>(data, full, 6);
+                    std::size_t rows = 0;
+                    for (; !rows_in.done() && rows < capacity; ++rows)
+                        rows_in.row(ids[rows], parent[rows], depth[rows], x[rows], y[rows], w[rows], h[rows]);
+
+                    // a short last batch moves its columns down; then the
+                    // padding is zeroed and the root marked null.
+                    std::vector<buffer> at = body_layout(rows, root);
+                    for (std::size_t k = 1; k < at.size(); k += 2)
+                        if (at[k].offset != full[k].offset)
+                            std::memmove(data + at[k].offset, data + full[k].offset, std::size_t(at[k].length));
+                    for (const buffer &r : at)
+                        std::memset(data + r.offset + r.length, 0, padded(std::size_t(r.length)) - std::size_t(r.length));
+                    if (root)
+                    {
+                        std::memset(data + at[2].offset, 0xFF, std::size_t(at[2].length));
+                        data[std::size_t(at[2].offset)] = std::byte(0xFE);
+                    }
+                    std::size_t length = std::size_t(at.back().offset) + padded(std::size_t(at.back().length));
+
+                    builder b;
+                    std::vector<field_node> nodes;
+                    for (const column &c : columns)
+                        nodes.push_back({std::int64_t(rows), c.nullable && root ? 1 : 0});
+                    std::uint32_t buffers = b.structs(at), fields = b.structs(nodes);
+                    b.start();
+                    b.add(0, std::int64_t(rows));
+                    b.add_offset(1, fields);
+                    b.add_offset(2, buffers);
+                    std::uint32_t batch = b.end();
+                    std::size_t offset = written;
+                    std::size_t meta = message(put, b, header_record_batch, batch, std::int64_t(length));
+                    put(reinterpret_cast<const char *>(data), length);
+                    blocks.push_back({std::int64_t(offset), std::int32_t(meta), 0, std::int64_t(length)});
+                }
+
+                std::uint32_t end_of_stream[2] = {0xFFFFFFFF, 0};
+                put(reinterpret_cast<const char *>(end_of_stream), 8);
+                if (!f.file)
+                    return;
+
+                // the footer repeats the schema and indexes the batches.
+                builder b;
+                std::uint32_t batches = b.structs(blocks), dictionaries = b.structs(std::vector<block>{});
+                std::uint32_t s = schema(b);
+                b.start();
+                b.add(0, metadata_v5);
+                b.add_offset(1, s);
+                b.add_offset(2, dictionaries);
+                b.add_offset(3, batches);
+                b.finish(b.end());
+                put(reinterpret_cast<const char *>(b.data()), b.size());
+                std::int32_t footer = std::int32_t(b.size());
+                put(reinterpret_cast<const char *>(&footer), 4);
+                put("ARROW1", 6);
+            }
+        } // namespace details
+
+        /// write the laid-out tree at t to out as Arrow IPC, one row per
+        /// node in preorder.
+        template <TreeNode Node, TextSink Out>
+        void write(Node *t, Out &&out, const format &f = {})
+        {
+            details::node_rows<Node> rows(t);
+            details::write(rows, out, f);
+        }
+
+        /// the same for a succinct tree laid out into c: x and y come from
+        /// c by preorder id, w and h from the tree. false, and nothing
+        /// written, if c does not hold one position per node.
+        template <TextSink Out>
+        bool write(const succinct::tree &t, const succinct::coords &c, Out &&out, const format &f = {})
+        {
+            if (t.size() == 0 || c.x.size() != t.size() || c.y.size() != t.size())
+                return false;
+            details::succinct_rows rows(t, c);
+            details::write(rows, out, f);
+            return true;
+        }
+
+    } // namespace arrow
+} // namespace layout
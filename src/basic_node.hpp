@@ -0,0 +1,34 @@
+/**
+ *
+ * a ready-made node type satisfying layout::TreeNode, for callers that do
+ * not need their own node struct.
+ *
+ */
+
+#pragma once
+#include "layout.hpp"
+#include <vector>
+
+namespace layout
+{
+
+    template <typename T = double>
+    struct basic_node
+    {
+        std::vector<basic_node *> children;
+        basic_node *parent = nullptr;
+        T x = 0, y = 0, w = 0, h = 0;
+        T prelim = 0, mod = 0, shift = 0, change = 0;
+        basic_node *tl = nullptr, *tr = nullptr; // left and right threads
+        basic_node *el = nullptr, *er = nullptr; // extreme left and right nodes
+        T msel = 0, mser = 0;
+
+        constexpr basic_node *add_child(basic_node *c)
+        {
+            c->parent = this;
+            children.push_back(c);
+            return c;
+        }
+    };
+
+} // namespace layout
@@ -0,0 +1,336 @@
+/**
+ *
+ * streaming reader and writer for trees as nested JSON objects:
+ *
+ *   {"w": 50, "h": 20, "children": [{"w": 40, "h": 15}, ...]}
+ *
+ * nodes are created as the text is read, by a callable alloc(parent), so
+ * they can go straight into an arena; there is no document tree in between.
+ * every node's children vector is filled once, with the exact size, when
+ * its "children" array closes.
+ *
+ *   NodeArena arena;
+ *   layout::mapped_file f("tree.json");
+ *   layout::json::reader r(f.text());
+ *   Node *root = r.next([&](Node *parent) { return arena.alloc(parent); });
+ *
+ * members may come in any order; "w" and "h" default to whatever alloc
+ * left in the node and "children" (which may be null) to none. other
+ * members are skipped without being checked in detail. several documents
+ * may follow each other (JSON lines).
+ *
+ * the reader does not recurse, so the tree may be as deep as memory allows.
+ * on an error the nodes made so far stay with the allocator.
+ *
+ * write() produces the same shape with the layout added, "x" and "y"
+ * first, so its output reads back in. like svg::write it goes through the
+ * tree by preorder id, so blocks of nodes can be formatted on several
+ * threads: a node's text depends only on its own depth, the next node's
+ * depth and whether it has children.
+ *
+ */
+
+#pragma once
+#include "layout.hpp"
+#include "metrics.hpp"
+#include "text_input.hpp"
+#include "text_output.hpp"
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace layout
+{
+    namespace json
+    {
+        // the node type an allocator makes.
+        template <typename Alloc>
+        using node_t = std::remove_pointer_t<std::invoke_result_t<Alloc &, std::nullptr_t>>;
+
+        template <typename Alloc>
+        concept NodeAllocator = requires(Alloc &a, node_t<Alloc> *n) {
+            { a(n) } -> std::convertible_to<node_t<Alloc> *>;
+            n->children.assign(&n, &n);
+        } && TreeNode<node_t<Alloc>>;
+
+        namespace details
+        {
+            using namespace layout::details;
+
+            inline void skip(const char *&p, const char *end)
+            {
+                while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+                    ++p;
+            }
+
+            // p is just past the opening quote; leaves p past the closing
+            // one and out on the raw text in between (escapes kept). keys
+            // are short, so a plain loop beats memchr here.
+            inline bool string(const char *&p, const char *end, std::string_view &out)
+            {
+                const char *first = p;
+                for (; p < end; ++p)
+                {
+                    if (*p == '"')
+                    {
+                        out = {first, std::size_t(p++ - first)};
+                        return true;
+                    }
+                    if (*p == '\\' && ++p == end)
+                        return false;
+                }
+                return false;
+            }
+
+            // any value: nested objects and arrays are skipped by counting
+            // brackets, scalars up to the next delimiter.
+            inline bool skip_value(const char *&p, const char *end)
+            {
+                std::string_view s;
+                if (p == end)
+                    return false;
+                if (*p == '"')
+                    return string(++p, end, s);
+                if (*p != '{' && *p != '[')
+                {
+                    const char *first = p;
+                    while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' &&
+                           *p != '\n' && *p != '\r' && *p != '\t')
+                        ++p;
+                    return p > first;
+                }
+                std::size_t depth = 0;
+                while (p < end)
+                {
+                    char c = *p++;
+                    if (c == '"' && !string(p, end, s))
+                        return false;
+                    else if (c == '{' || c == '[')
+                        ++depth;
+                    else if ((c == '}' || c == ']') && --depth == 0)
+                        return true;
+                }
+                return false;
+            }
+        } // namespace details
+
+        // —————————————————————————————————————————————————————
+        // reads the trees of a text one after the other.
+        class reader
+        {
+        public:
+            explicit reader(std::string_view text) : p_(text.data()), begin_(text.data()), end_(text.data() + text.size()) {}
+
+            /// read the next tree, making its nodes with alloc(parent), and
+            /// return its root. nullptr at the end of the text or on an
+            /// error (see failed()).
+            template <typename Alloc>
+                requires NodeAllocator<Alloc>
+            node_t<Alloc> *next(Alloc &&alloc)
+            {
+                using Node = node_t<Alloc>;
+                details::skip(p_, end_);
+                if (failed_ || p_ == end_)
+                    return nullptr;
+                Node *root = parse<Node>(alloc);
+                if (!root)
+                    failed_ = true;
+                return root;
+            }
+
+            /// true once next() has met text it cannot read.
+            bool failed() const { return failed_; }
+
+            /// bytes read so far; where the error is after a failure.
+            std::size_t offset() const { return std::size_t(p_ - begin_); }
+
+        private:
+            template <typename Node>
+            struct open
+            {
+                Node *n;
+                std::size_t first; // its first child in pending, once "children" is open
+            };
+
+            enum class state
+            {
+                member_or_end, // after '{'
+                member,        // after ',' in an object
+                after_member,
+                child_or_end, // after '[' of "children"
+                child,        // after ',' in "children"
+                after_child,
+            };
+
+            template <typename Node, typename Alloc>
+            Node *parse(Alloc &alloc)
+            {
+                std::vector<open<Node>> stack;
+                std::vector<Node *> pending; // children whose ']' is still to come
+
+                auto make = [&](Node *parent)
+                {
+                    Node *n = alloc(parent);
+                    n->parent = parent;
+                    stack.push_back({n, 0});
+                    return n;
+                };
+
+                const char *&p = p_;
+                if (*p != '{')
+                    return nullptr;
+                ++p;
+                Node *root = make(nullptr);
+                state s = state::member_or_end;
+                for (;;)
+                {
+                    details::skip(p, end_);
+                    if (p == end_)
+                        return nullptr;
+                    char c = *p++;
+                    switch (s)
+                    {
+                    case state::member_or_end:
+                    case state::member:
+                    {
+                        if (c == '}' && s == state::member_or_end)
+                            break; // closes the object, below
+                        std::string_view key;
+                        if (c != '"' || !details::string(p, end_, key))
+                            return nullptr;
+                        details::skip(p, end_);
+                        if (p == end_ || *p++ != ':')
+                            return nullptr;
+                        details::skip(p, end_);
+                        Node *n = stack.back().n;
+                        if (key.size() == 1 && (key[0] == 'w' || key[0] == 'h'))
+                        {
+                            double v;
+                            if (!details::read_number(p, end_, v))
+                                return nullptr;
+                            (key[0] == 'w' ? n->w : n->h) = decltype(n->w)(v);
+                            s = state::after_member;
+                        }
+                        else if (key == "children" && std::string_view(p, std::size_t(end_ - p)).starts_with("null"))
+                        {
+                            p += 4;
+                            s = state::after_member;
+                        }
+                        else if (key == "children")
+                        {
+                            if (p == end_ || *p++ != '[')
+                                return nullptr;
+                            stack.back().first = pending.size();
+                            s = state::child_or_end;
+                        }
+                        else
+                        {
+                            if (!details::skip_value(p, end_))
+                                return nullptr;
+                            s = state::after_member;
+                        }
+                        continue;
+                    }
+                    case state::after_member:
+                        if (c == ',')
+                        {
+                            s = state::member;
+                            continue;
+                        }
+                        if (c != '}')
+                            return nullptr;
+                        break; // closes the object, below
+                    case state::child_or_end:
+                    case state::child:
+                        if (c == ']' && s == state::child_or_end)
+                        {
+                            close_children(stack.back(), pending);
+                            s = state::after_member;
+                            continue;
+                        }
+                        if (c != '{')
+                            return nullptr;
+                        pending.push_back(make(stack.back().n));
+                        s = state::member_or_end;
+                        continue;
+                    case state::after_child:
+                        if (c == ',')
+                            s = state::child;
+                        else if (c == ']')
+                        {
+                            close_children(stack.back(), pending);
+                            s = state::after_member;
+                        }
+                        else
+                            return nullptr;
+                        continue;
+                    }
+
+                    // an object ended.
+                    stack.pop_back();
+                    if (stack.empty())
+                        return root;
+                    s = state::after_child;
+                }
+            }
+
+            template <typename Node>
+            static void close_children(const open<Node> &o, std::vector<Node *> &pending)
+            {
+                o.n->children.assign(pending.begin() + std::ptrdiff_t(o.first), pending.end());
+                pending.resize(o.first);
+            }
+
+            const char *p_, *begin_, *end_;
+            bool failed_ = false;
+        };
+
+        // —————————————————————————————————————————————————————
+        struct format
+        {
+            int decimals = 2;     // places kept of every number
+            unsigned threads = 1; // formatting threads; 0: one per hardware thread
+        };
+
+        /// write the laid-out tree at t to out as one line of JSON.
+        template <TreeNode Node, TextSink Out>
+        void write(Node *t, Out &&out, const format &f = {})
+        {
+            metrics::table<Node> m;
+            metrics::compute(t, m, f.threads);
+            std::size_t n = m.size();
+            layout::details::write_blocks(n, f.threads, [&](text_buffer &b, std::size_t first, std::size_t last)
+                                          {
+                                              for (std::size_t v = first; v < last; ++v)
+                                              {
+                                                  const Node *c = m.node(v);
+                                                  b.put(R"({"x":)");
+                                                  b.number(details::units<Node>(c->x), f.decimals);
+                                                  b.put(R"(,"y":)");
+                                                  b.number(details::units<Node>(c->y), f.decimals);
+                                                  b.put(R"(,"w":)");
+                                                  b.number(details::units<Node>(c->w), f.decimals);
+                                                  b.put(R"(,"h":)");
+                                                  b.number(details::units<Node>(c->h), f.decimals);
+                                                  if (m[v].size > 1)
+                                                  {
+                                                      b.put(R"(,"children":[)"); // the first child is next
+                                                      continue;
+                                                  }
+                                                  b.put('}');
+                                                  // close the ancestors whose last node this is.
+                                                  std::uint32_t up = v + 1 < n ? m[v].depth - m[v + 1].depth : m[v].depth;
+                                                  for (; up > 0; --up)
+                                                      b.put("]}");
+                                                  if (v + 1 < n)
+                                                      b.put(',');
+                                              }
+                                          },
+                                          out);
+            out("\n", 1);
+        }
+
+    } // namespace json
+} // namespace layout
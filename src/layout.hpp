@@ -8,9 +8,12 @@
  */
 
 #pragma once
-#include <memory>
+#include <vector>
 #include <concepts>
 #include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
 
 namespace layout
 {
@@ -37,71 +40,294 @@ namespace layout
     };
     // —————————————————————————————————————————————————————
 
+    struct constant_separation;
+
+    /// direction the tree grows in, from the root towards its leaves.
+    enum class orientation
+    {
+        top_down,
+        bottom_up,
+        left_right,
+        right_left,
+    };
+
+    /// layout options.
+    struct options
+    {
+        // V_SPACING separates levels and H_SPACING siblings in every orientation.
+        layout::orientation orientation = orientation::top_down;
+
+        // align every node of a depth on a shared baseline (classic level
+        // alignment) instead of hanging it below its own parent.
+        bool layered = false;
+
+        // mind-map layout: the root's children are split into two groups of
+        // about the same total subtree size. the first group grows in
+        // `orientation`, the second in the mirrored direction, and both are
+        // centred on the root.
+        bool two_sided = false;
+
+        // map the tidy breadth coordinate to an angle and depth to a radius,
+        // with the root centred on the origin. x,y are still the top-left
+        // corner of each node. orientation is ignored.
+        bool radial = false;
+    };
+
     // ─── implementation details ────────────────────────────────────────
     namespace details
     {
 
-        // internal small linked‐list:
+        // internal small stack of (lowY, index) pairs, head at the back.
+        // kept in a vector rather than a linked list so the layout stays
+        // usable in constant evaluation.
+        template <typename C>
         struct IYL
         {
-            double lowY;
+            C lowY;
             int index;
-            std::unique_ptr<IYL> nxt;
-            IYL(double l, int i, std::unique_ptr<IYL> n)
-                : lowY(l), index(i), nxt(std::move(n)) {}
         };
 
         // spacing constants only used by the algo:
-        constexpr double V_SPACING = 20.0;
-        constexpr double H_SPACING = 20.0;
+        inline constexpr double V_SPACING = 20.0;
+        inline constexpr double H_SPACING = 20.0;
 
-        // forward declarations of internal templates:
+        // the scalar type the algorithm computes in. floating point nodes
+        // are computed in double; nodes with integer fields are treated as
+        // fixed-point and computed in their own integer type, so results are
+        // exact and identical across compilers and -ffast-math builds.
+        template <typename Node>
+        using field_t = std::remove_cvref_t<decltype(std::declval<Node &>().prelim)>;
+
+        template <typename Node>
+        using coord_t = std::conditional_t<std::is_integral_v<field_t<Node>>, field_t<Node>, double>;
+
+        // fixed-point nodes may declare `static constexpr int fraction_bits`,
+        // otherwise integer fields are plain integer units.
+        template <typename Node>
+        constexpr int fraction_bits()
+        {
+            if constexpr (requires { Node::fraction_bits; })
+                return Node::fraction_bits;
+            else
+                return 0;
+        }
+
+        template <typename Node>
+        constexpr coord_t<Node> spacing(double s)
+        {
+            if constexpr (std::is_integral_v<coord_t<Node>>)
+                return coord_t<Node>(s * double(std::int64_t(1) << fraction_bits<Node>()));
+            else
+                return s;
+        }
+
+    } // namespace details
+
+    /// separation policy: the gap kept between two adjacent contour nodes,
+    /// `left` from the subtrees already placed and `right` from the subtree
+    /// being placed. `depth` is how many levels the deeper of the two is
+    /// below the siblings being merged, so it is 0 when comparing the
+    /// siblings themselves; compare parents to tell siblings from cousins.
+    /// any callable with this signature can be passed to layout().
+    ///
+    /// a policy may also take just the two nodes, as this default does; then
+    /// no depth is computed. otherwise contour nodes reached through a thread
+    /// have their depth counted up their parents, which costs up to the
+    /// tree's height per thread followed. this default inlines to the
+    /// H_SPACING constant.
+    struct constant_separation
+    {
         template <TreeNode Node>
-        void firstwalk(Node *t);
+        constexpr auto operator()(const Node *, const Node *) const
+        {
+            return details::spacing<Node>(details::H_SPACING);
+        }
+
         template <TreeNode Node>
-        void secondwalk(Node *t, double modsum);
+        constexpr auto operator()(const Node *l, const Node *r, std::size_t) const
+        {
+            return (*this)(l, r);
+        }
+    };
+
+    namespace details
+    {
+
+        // the algorithm works on a breadth axis (across siblings) and a depth
+        // axis (parent to child). the orientation picks the node fields that
+        // play each role, so no pre or post pass is needed to rotate a tree.
+        template <orientation O>
+        constexpr bool horizontal = O == orientation::left_right || O == orientation::right_left;
+
+        // size across siblings.
+        template <orientation O, TreeNode Node>
+        constexpr auto &breadth(Node *t)
+        {
+            if constexpr (horizontal<O>)
+                return t->h;
+            else
+                return t->w;
+        }
+
+        // size from parent to child.
+        template <orientation O, TreeNode Node>
+        constexpr auto &extent(Node *t)
+        {
+            if constexpr (horizontal<O>)
+                return t->w;
+            else
+                return t->h;
+        }
+
+        template <orientation O, TreeNode Node>
+        constexpr auto &breadth_pos(Node *t)
+        {
+            if constexpr (horizontal<O>)
+                return t->y;
+            else
+                return t->x;
+        }
+
+        template <orientation O, TreeNode Node>
+        constexpr auto &depth_pos(Node *t)
+        {
+            if constexpr (horizontal<O>)
+                return t->x;
+            else
+                return t->y;
+        }
+
+        // flip the depth axis for trees growing up or to the left, keeping
+        // the root's near edge at 0.
+        template <orientation O, TreeNode Node>
+        constexpr void mirror(Node *t)
+        {
+            if constexpr (O == orientation::bottom_up || O == orientation::right_left)
+                depth_pos<O>(t) = -(coord_t<Node>(depth_pos<O>(t)) + extent<O>(t));
+        }
+
+        // mixed precision: float fields are stored narrow but every sum is
+        // carried in double, so wide trees do not drift as spacing deltas
+        // accumulate over millions of siblings.
+        template <typename Node>
+        constexpr bool mixed_precision = std::is_floating_point_v<field_t<Node>> &&
+                                         sizeof(field_t<Node>) < sizeof(coord_t<Node>);
+
+        // compensated (Neumaier) running sum.
+        template <typename C>
+        struct compensated
+        {
+            C sum = 0, c = 0;
+            constexpr void add(C v)
+            {
+                C t = sum + v;
+                if ((sum < 0 ? -sum : sum) >= (v < 0 ? -v : v))
+                    c += (sum - t) + v;
+                else
+                    c += (v - t) + sum;
+                sum = t;
+            }
+            constexpr C value() const { return sum + c; }
+        };
+
+        // forward declarations of internal templates:
+        template <orientation O = orientation::top_down, TreeNode Node, typename Sep = constant_separation>
+        constexpr void firstwalk(Node *t, const Sep &sep = {});
+        template <orientation O = orientation::top_down, TreeNode Node, typename Sep = constant_separation>
+        constexpr void firstwalk_layered(Node *t, const std::vector<coord_t<Node>> &baseline, std::size_t depth, const Sep &sep = {});
+        template <orientation O = orientation::top_down, TreeNode Node, typename Sep = constant_separation>
+        constexpr void separate_layered(Node *t, int i, const std::vector<IYL<coord_t<Node>>> &ih, int first = 0, const Sep &sep = {});
+        template <orientation O = orientation::top_down, TreeNode Node>
+        constexpr void secondwalk(Node *t, coord_t<Node> modsum);
+        template <orientation O = orientation::top_down, TreeNode Node>
+        constexpr void secondwalk_mixed(Node *t, coord_t<Node> modsum);
+        template <TreeNode Node>
+        struct radial_sink;
+        template <orientation O = orientation::top_down, TreeNode Node>
+        constexpr void secondwalk_radial(Node *t, coord_t<Node> modsum, radial_sink<Node> &sink);
         template <TreeNode Node>
-        void set_extremes(Node *t);
+        constexpr void set_extremes(Node *t);
         template <TreeNode Node>
-        double bottom(Node *t);
+        constexpr void reset(Node *t);
+        template <orientation O = orientation::top_down, TreeNode Node>
+        constexpr coord_t<Node> bottom(Node *t);
+        template <orientation O = orientation::top_down, TreeNode Node, typename Sep = constant_separation>
+        constexpr void separate(Node *t, int i, const std::vector<IYL<coord_t<Node>>> &ih, int first = 0, const Sep &sep = {});
         template <TreeNode Node>
-        void separate(Node *t, int i, std::unique_ptr<IYL> &ih);
+        constexpr void move_subtree(Node *t, int i, int si, coord_t<Node> dist);
         template <TreeNode Node>
-        void move_subtree(Node *t, int i, int si, double dist);
+        constexpr Node *next_right_contour(Node *t);
         template <TreeNode Node>
-        Node *next_right_contour(Node *t);
+        constexpr Node *next_left_contour(Node *t);
         template <TreeNode Node>
-        Node *next_left_contour(Node *t);
+        constexpr void set_left_thread(Node *t, int i, Node *cl, coord_t<Node> mods, int first = 0);
         template <TreeNode Node>
-        void set_left_thread(Node *t, int i, Node *cl, double mods);
+        constexpr void set_right_thread(Node *t, int i, Node *cr, coord_t<Node> mods);
         template <TreeNode Node>
-        void set_right_thread(Node *t, int i, Node *cr, double mods);
+        constexpr void distribute_extra(Node *t, int i, int si, coord_t<Node> dist);
+        template <orientation O = orientation::top_down, TreeNode Node>
+        constexpr void position_root(Node *t);
+        template <orientation O = orientation::top_down, TreeNode Node>
+        constexpr coord_t<Node> center_prelim(Node *t, std::size_t first, std::size_t last);
         template <TreeNode Node>
-        void distribute_extra(Node *t, int i, int si, double dist);
+        constexpr void add_child_spacing(Node *t);
+        template <orientation O = orientation::top_down, TreeNode Node>
+        constexpr void secondwalk_root(Node *t, const options &opt);
+
+        // policies that take a depth as well as the two nodes.
+        template <typename Sep, typename Node>
+        constexpr bool depth_aware = !std::is_invocable_v<const Sep &, const Node *, const Node *>;
+
+        template <typename Node, typename Sep>
+        constexpr auto gap(const Sep &sep, const Node *l, const Node *r, std::size_t depth)
+        {
+            if constexpr (depth_aware<Sep, Node>)
+                return sep(l, r, depth);
+            else
+                return sep(l, r);
+        }
+
         template <TreeNode Node>
-        void position_root(Node *t);
+        // levels n is below the children of t, counted up the parents. roots
+        // of a forest do not point to their invisible parent t, so a null
+        // parent ends the count as well.
+        constexpr std::size_t levels_below(const Node *n, const Node *t)
+        {
+            std::size_t d = 0;
+            for (; n->parent && n->parent != t; n = n->parent)
+                ++d;
+            return d;
+        }
+
         template <TreeNode Node>
-        void add_child_spacing(Node *t);
+        // the node that tells the IYL chain how deep the subtree of child c
+        // reaches: its lowest node, not c itself. for the first child that is
+        // its left extreme, for the others their right one, read right after
+        // c's own walk, before separate() moves er further right.
+        constexpr Node *iyl_extreme(Node *c, bool first)
+        {
+            return first ? c->el : c->er;
+        }
 
         // helper to update the IYL chain:
-        inline std::unique_ptr<IYL> updateIYL(double miny,
-                                              int i,
-                                              std::unique_ptr<IYL> oldHead)
+        template <typename C>
+        constexpr void updateIYL(C miny, int i, std::vector<IYL<C>> &ih)
         {
-            while (oldHead && miny >= oldHead->lowY)
-                oldHead = std::move(oldHead->nxt);
-            return std::make_unique<IYL>(miny, i, std::move(oldHead));
+            while (!ih.empty() && miny >= ih.back().lowY)
+                ih.pop_back();
+            ih.push_back({miny, i});
         }
 
         // ─── Definitions ─────────────────────────────────────────────────
 
-        template <TreeNode Node>
-        void firstwalk(Node *t)
+        template <orientation O, TreeNode Node, typename Sep>
+        constexpr void firstwalk(Node *t, const Sep &sep)
         {
+            reset(t);
             if (t->parent)
-                t->y = t->parent->y + t->parent->h + details::V_SPACING;
+                depth_pos<O>(t) = depth_pos<O>(t->parent) + extent<O>(t->parent) + spacing<Node>(V_SPACING);
             else
-                t->y = 0;
+                depth_pos<O>(t) = 0;
 
             if (t->children.empty())
             {
@@ -110,25 +336,126 @@ namespace layout
             }
 
             // first child
-            firstwalk(t->children[0]);
-            std::unique_ptr<IYL> ih = nullptr;
-            ih = updateIYL(bottom(t->children[0]), 0, std::move(ih));
+            firstwalk<O>(t->children[0], sep);
+            std::vector<IYL<coord_t<Node>>> ih;
+            updateIYL(bottom<O>(iyl_extreme(t->children[0], true)), 0, ih);
 
             // remaining children
             for (int i = 1; i < (int)t->children.size(); ++i)
             {
-                firstwalk(t->children[i]);
-                double minY = bottom(t->children[i]);
-                separate(t, i, ih);
-                ih = updateIYL(minY, i, std::move(ih));
+                firstwalk<O>(t->children[i], sep);
+                coord_t<Node> minY = bottom<O>(iyl_extreme(t->children[i], false));
+                separate<O>(t, i, ih, 0, sep);
+                updateIYL(minY, i, ih);
+            }
+
+            position_root<O>(t);
+            set_extremes(t);
+        }
+
+        template <orientation O, TreeNode Node>
+        // pre-pass for layered mode: tallest node of every depth.
+        constexpr void level_heights(Node *t, std::vector<coord_t<Node>> &levels, std::size_t depth)
+        {
+            if (levels.size() <= depth)
+                levels.push_back(extent<O>(t));
+            else if (levels[depth] < extent<O>(t))
+                levels[depth] = extent<O>(t);
+            for (Node *c : t->children)
+                level_heights<O>(c, levels, depth + 1);
+        }
+
+        template <orientation O, TreeNode Node>
+        // shared y of every depth: each level starts below the tallest node of the previous one.
+        constexpr std::vector<coord_t<Node>> level_baselines(Node *const *roots, std::size_t n)
+        {
+            std::vector<coord_t<Node>> levels;
+            for (std::size_t i = 0; i < n; ++i)
+                level_heights<O>(roots[i], levels, 0);
+            coord_t<Node> y = 0;
+            for (coord_t<Node> &l : levels)
+            {
+                coord_t<Node> h = l;
+                l = y;
+                y += h + spacing<Node>(V_SPACING);
+            }
+            return levels;
+        }
+
+        template <orientation O, TreeNode Node, typename Sep>
+        // firstwalk for layered mode. a subtree's depth is told by the y of
+        // its extreme left node, which is the deepest one.
+        constexpr void firstwalk_layered(Node *t, const std::vector<coord_t<Node>> &baseline, std::size_t depth, const Sep &sep)
+        {
+            reset(t);
+            depth_pos<O>(t) = baseline[depth];
+
+            if (t->children.empty())
+            {
+                set_extremes(t);
+                return;
+            }
+
+            firstwalk_layered<O>(t->children[0], baseline, depth + 1, sep);
+            std::vector<IYL<coord_t<Node>>> ih;
+            updateIYL(coord_t<Node>(depth_pos<O>(iyl_extreme(t->children[0], true))), 0, ih);
+
+            for (int i = 1; i < (int)t->children.size(); ++i)
+            {
+                firstwalk_layered<O>(t->children[i], baseline, depth + 1, sep);
+                coord_t<Node> lowY = depth_pos<O>(iyl_extreme(t->children[i], false));
+                separate_layered<O>(t, i, ih, 0, sep);
+                updateIYL(lowY, i, ih);
             }
 
-            position_root(t);
+            position_root<O>(t);
             set_extremes(t);
         }
 
+        template <orientation O, TreeNode Node, typename Sep>
+        // separate for layered mode: both contours step down one level at a
+        // time, so there are no bottoms to compare, and the step count is the
+        // depth of both nodes (threads lead one level down as well).
+        constexpr void separate_layered(Node *t, int i, const std::vector<IYL<coord_t<Node>>> &ih, int first, const Sep &sep)
+        {
+            using C = coord_t<Node>;
+            Node *sr = t->children[i - 1];
+            C mssr = sr->mod;
+            Node *cl = t->children[i];
+            C mscl = cl->mod;
+            std::size_t cursor = ih.size();
+
+            for (std::size_t depth = 0; sr && cl; ++depth)
+            {
+                while (cursor && C(depth_pos<O>(sr)) > ih[cursor - 1].lowY)
+                    --cursor;
+
+                C dist =
+                    (mssr + sr->prelim + breadth<O>(sr) + C(gap(sep, sr, cl, depth))) - (mscl + cl->prelim);
+
+                if (dist > 0)
+                {
+                    mscl += dist;
+                    int si = cursor ? ih[cursor - 1].index : (i - 1);
+                    move_subtree(t, i, si, dist);
+                }
+
+                sr = next_right_contour(sr);
+                if (sr)
+                    mssr += sr->mod;
+                cl = next_left_contour(cl);
+                if (cl)
+                    mscl += cl->mod;
+            }
+
+            if (sr == nullptr && cl != nullptr)
+                set_left_thread(t, i, cl, mscl, first);
+            else if (sr != nullptr && cl == nullptr)
+                set_right_thread(t, i, sr, mssr);
+        }
+
         template <TreeNode Node>
-        void set_extremes(Node *t)
+        constexpr void set_extremes(Node *t)
         {
             if (t->children.size() == 0)
             {
@@ -147,111 +474,147 @@ namespace layout
         }
 
         template <TreeNode Node>
-        void separate(Node *t, int i, std::unique_ptr<IYL> &ih)
+        // clear what a previous layout left in t, so laying a tree out again
+        // (or a subtree on its own) gives the same result as the first time.
+        constexpr void reset(Node *t)
         {
+            t->prelim = t->mod = t->shift = t->change = 0;
+            t->tl = t->tr = nullptr;
+        }
+
+        template <orientation O, TreeNode Node, typename Sep>
+        constexpr void separate(Node *t, int i, const std::vector<IYL<coord_t<Node>>> &ih, int first, const Sep &sep)
+        {
+            using C = coord_t<Node>;
             Node *sr = t->children[i - 1];
-            double mssr = sr->mod;
+            C mssr = sr->mod;
             Node *cl = t->children[i];
-            double mscl = cl->mod;
+            C mscl = cl->mod;
 
-            // create a (raw) pointer cursor into the chain:
-            IYL *cursor = ih.get();
+            // cursor into the chain, starting at the head:
+            std::size_t cursor = ih.size();
+            // levels below t's children. the contours step by bottoms, not by
+            // levels, so each side keeps its own; only policies that ask for
+            // a depth pay for them.
+            std::size_t dsr = 0, dcl = 0;
 
             while (sr && cl)
             {
                 // advance the cursor, but *do not* touch ih!
-                while (cursor && bottom(sr) > cursor->lowY)
-                    cursor = cursor->nxt.get();
+                while (cursor && bottom<O>(sr) > ih[cursor - 1].lowY)
+                    --cursor;
 
-                double dist =
-                    (mssr + sr->prelim + sr->w + details::H_SPACING) - (mscl + cl->prelim);
+                C dist =
+                    (mssr + sr->prelim + breadth<O>(sr) + C(gap(sep, sr, cl, dsr > dcl ? dsr : dcl))) - (mscl + cl->prelim);
 
                 if (dist > 0)
                 {
                     mscl += dist;
-                    // use cursor->index if cursor!=nullptr, otherwise fall back
-                    int si = cursor ? cursor->index : (i - 1);
+                    // use the cursor's index if it is still in the chain, otherwise fall back
+                    int si = cursor ? ih[cursor - 1].index : (i - 1);
                     move_subtree(t, i, si, dist);
                 }
 
-                double sy = bottom(sr), cy = bottom(cl);
+                C sy = bottom<O>(sr), cy = bottom<O>(cl);
                 if (sy <= cy)
                 {
+                    bool thread = sr->children.size() == 0;
                     sr = next_right_contour(sr);
                     if (sr)
+                    {
                         mssr += sr->mod;
+                        if constexpr (depth_aware<Sep, Node>)
+                            dsr = thread ? levels_below(sr, t) : dsr + 1;
+                    }
                 }
                 if (sy >= cy)
                 {
+                    bool thread = cl->children.size() == 0;
                     cl = next_left_contour(cl);
                     if (cl)
+                    {
                         mscl += cl->mod;
+                        if constexpr (depth_aware<Sep, Node>)
+                            dcl = thread ? levels_below(cl, t) : dcl + 1;
+                    }
                 }
             }
             // set threads and update extreme nodes
             // in the first case, the current subtree must talled than the left siblings.
             if (sr == nullptr && cl != nullptr)
-                set_left_thread(t, i, cl, mscl);
+                set_left_thread(t, i, cl, mscl, first);
             // in this case, the left siblings must be taller than the current subtree.
             else if (sr != nullptr && cl == nullptr)
                 set_right_thread(t, i, sr, mssr);
         }
 
         template <TreeNode Node>
-        Node *next_left_contour(Node *t)
+        constexpr Node *next_left_contour(Node *t)
         {
             return t->children.size() == 0 ? t->tl : t->children[0];
         }
 
         template <TreeNode Node>
-        Node *next_right_contour(Node *t)
+        constexpr Node *next_right_contour(Node *t)
         {
             return t->children.size() == 0 ? t->tr : t->children[t->children.size() - 1];
         }
 
-        template <TreeNode Node>
-        double bottom(Node *t)
+        template <orientation O, TreeNode Node>
+        constexpr coord_t<Node> bottom(Node *t)
         {
-            return t->y + t->h;
+            return coord_t<Node>(depth_pos<O>(t)) + extent<O>(t);
         }
 
         template <TreeNode Node>
-        void set_left_thread(Node *t, int i, Node *cl, double modsumcl)
+        // `first` is the leftmost child taking part in the merge (see firstwalk_range).
+        constexpr void set_left_thread(Node *t, int i, Node *cl, coord_t<Node> modsumcl, int first)
         {
-            Node *li = t->children[0]->el;
+            Node *li = t->children[first]->el;
             li->tl = cl;
             // change mod so that the sum of modifier after following thread is corrent.
-            double diff = (modsumcl - cl->mod) - t->children[0]->msel;
+            coord_t<Node> diff = (modsumcl - cl->mod) - t->children[first]->msel;
             li->mod += diff;
             // change preliminary x coordinate so that the node does not move.
             li->prelim -= diff;
             // update extreme node and its sum of modifiers.
-            t->children[0]->el = t->children[i]->el;
-            t->children[0]->msel = t->children[i]->msel;
+            t->children[first]->el = t->children[i]->el;
+            t->children[first]->msel = t->children[i]->msel;
         }
 
         template <TreeNode Node>
         // symmertical to set_left_thread
-        void set_right_thread(Node *t, int i, Node *sr, double modsumsr)
+        constexpr void set_right_thread(Node *t, int i, Node *sr, coord_t<Node> modsumsr)
         {
             Node *ri = t->children[i]->er;
             ri->tr = sr;
-            double diff = (modsumsr - sr->mod) - t->children[i]->mser;
+            coord_t<Node> diff = (modsumsr - sr->mod) - t->children[i]->mser;
             ri->mod += diff;
             ri->prelim -= diff;
             t->children[i]->er = t->children[i - 1]->er;
             t->children[i]->mser = t->children[i - 1]->mser;
         }
 
-        template <TreeNode Node>
-        void position_root(Node *t)
+        template <orientation O, TreeNode Node>
+        constexpr void position_root(Node *t)
+        {
+            t->prelim = center_prelim<O>(t, 0, t->children.size());
+        }
+
+        template <orientation O, TreeNode Node>
+        // prelim that centres t over its children [first, last), taking into account their mod.
+        constexpr coord_t<Node> center_prelim(Node *t, std::size_t first, std::size_t last)
         {
-            // position root between children, taking into account their mod.
-            t->prelim = (t->children[0]->prelim + t->children[0]->mod + t->children[t->children.size() - 1]->mod + t->children[t->children.size() - 1]->prelim + t->children[t->children.size() - 1]->w) / 2 - t->w / 2;
+            Node *l = t->children[first], *r = t->children[last - 1];
+            if constexpr (std::is_integral_v<coord_t<Node>>)
+                // fixed-point: halve once so the rounding is the same on every platform.
+                return (coord_t<Node>(l->prelim) + l->mod + r->mod + r->prelim + breadth<O>(r) - breadth<O>(t)) / 2;
+            else
+                return (coord_t<Node>(l->prelim) + l->mod + r->mod + r->prelim + breadth<O>(r)) / 2 - breadth<O>(t) / 2;
         }
 
         template <TreeNode Node>
-        void move_subtree(Node *t, int i, int si, double dist)
+        constexpr void move_subtree(Node *t, int i, int si, coord_t<Node> dist)
         {
             // move subtree by changing mod.
             t->children[i]->mod += dist;
@@ -261,34 +624,57 @@ namespace layout
         }
 
         template <TreeNode Node>
-        void distribute_extra(Node *t, int i, int si, double dist)
+        constexpr void distribute_extra(Node *t, int i, int si, coord_t<Node> dist)
         {
             // are there intermediate children?
             if (si != i - 1)
             {
-                double nr = i - si;
+                coord_t<Node> nr = i - si;
                 t->children[si + 1]->shift += dist / nr;
                 t->children[i]->shift -= dist / nr;
-                t->children[i]->change -= dist - dist / nr;
+                if constexpr (std::is_integral_v<coord_t<Node>>)
+                    // the truncated step must cancel exactly at child i.
+                    t->children[i]->change -= (nr - 1) * (dist / nr);
+                else
+                    t->children[i]->change -= dist - dist / nr;
             }
         }
 
-        template <TreeNode Node>
-        void secondwalk(Node *t, double modsum)
+        template <orientation O, TreeNode Node>
+        constexpr void secondwalk(Node *t, coord_t<Node> modsum)
         {
             modsum += t->mod;
-            // set absolute (non relative) horizontal coordinate.
-            t->x = t->prelim + modsum;
+            // set absolute (non relative) breadth coordinate.
+            breadth_pos<O>(t) = t->prelim + modsum;
+            mirror<O>(t);
             add_child_spacing(t);
             for (Node *c : t->children)
-                secondwalk(c, modsum);
+                secondwalk<O>(c, modsum);
+        }
+
+        template <orientation O, TreeNode Node>
+        // same as secondwalk + add_child_spacing, but the spacing delta is
+        // added to the double modsum instead of going through the float mod.
+        constexpr void secondwalk_mixed(Node *t, coord_t<Node> modsum)
+        {
+            breadth_pos<O>(t) = t->prelim + modsum;
+            mirror<O>(t);
+            compensated<coord_t<Node>> d, modsumdelta;
+            for (Node *c : t->children)
+            {
+                d.add(c->shift);
+                modsumdelta.add(d.value() + c->change);
+                coord_t<Node> mod = c->mod + modsumdelta.value();
+                c->mod = mod;
+                secondwalk_mixed<O>(c, modsum + mod);
+            }
         }
 
         template <TreeNode Node>
         // process change and shift to add intermediate spacing to mod.
-        void add_child_spacing(Node *t)
+        constexpr void add_child_spacing(Node *t)
         {
-            double d = 0, modsumdelta = 0;
+            coord_t<Node> d = 0, modsumdelta = 0;
             for (int i = 0; i < t->children.size(); i++)
             {
                 d += t->children[i]->shift;
@@ -297,14 +683,558 @@ namespace layout
             }
         };
 
+        // ─── radial output ───────────────────────────────────────────────
+
+        inline constexpr double PI = 3.14159265358979323846;
+
+        // odd series for sin on [-π/2, π/2], error below 3e-16.
+        constexpr double sin_poly(double x)
+        {
+            double x2 = x * x;
+            double p = -1.0 / 121645100408832000.0;
+            p = p * x2 + 1.0 / 355687428096000.0;
+            p = p * x2 - 1.0 / 1307674368000.0;
+            p = p * x2 + 1.0 / 6227020800.0;
+            p = p * x2 - 1.0 / 39916800.0;
+            p = p * x2 + 1.0 / 362880.0;
+            p = p * x2 - 1.0 / 5040.0;
+            p = p * x2 + 1.0 / 120.0;
+            p = p * x2 - 1.0 / 6.0;
+            return x + x * x2 * p;
+        }
+
+        // fold an angle in [-π, 2π] into [-π/2, π/2] keeping its sine.
+        constexpr double fold(double x)
+        {
+            x = x > PI ? x - 2 * PI : x;
+            return x > PI / 2 ? PI - x : (x < -PI / 2 ? -PI - x : x);
+        }
+
+        // sin and cos of a block of angles in [0, 2π). branch-free, so the
+        // loop vectorizes where calls to std::sin/std::cos would not.
+        constexpr void sincos_block(const double *a, double *s, double *c, std::size_t n)
+        {
+            for (std::size_t k = 0; k < n; ++k)
+            {
+                s[k] = sin_poly(fold(a[k]));
+                c[k] = sin_poly(fold(a[k] + PI / 2 - (a[k] > PI ? 2 * PI : 0)));
+            }
+        }
+
+        template <TreeNode Node>
+        constexpr field_t<Node> from_double(double v)
+        {
+            if constexpr (std::is_integral_v<field_t<Node>>)
+                return field_t<Node>(v < 0 ? v - 0.5 : v + 0.5);
+            else
+                return field_t<Node>(v);
+        }
+
+        // collects (node, angle, radius) during secondwalk and converts them
+        // to cartesian coordinates a block at a time.
+        template <TreeNode Node>
+        struct radial_sink
+        {
+            static constexpr std::size_t block = 256;
+            double start = 0, span = 1; // breadth range mapped onto the full circle
+            Node *node[block]{};
+            double angle[block]{}, radius[block]{};
+            std::size_t n = 0;
+
+            constexpr void push(Node *t, double center, double r)
+            {
+                node[n] = t;
+                angle[n] = 2 * PI * (center - start) / span;
+                radius[n] = r;
+                if (++n == block)
+                    flush();
+            }
+
+            constexpr void flush()
+            {
+                double s[block]{}, c[block]{};
+                sincos_block(angle, s, c, n);
+                for (std::size_t k = 0; k < n; ++k)
+                {
+                    node[k]->x = from_double<Node>(radius[k] * c[k] - double(node[k]->w) / 2);
+                    node[k]->y = from_double<Node>(radius[k] * s[k] - double(node[k]->h) / 2);
+                }
+                n = 0;
+            }
+        };
+
+        template <orientation O, TreeNode Node>
+        // breadth range of the whole tree, read off its outer contours.
+        constexpr void breadth_range(Node *t, coord_t<Node> &lo, coord_t<Node> &hi)
+        {
+            coord_t<Node> ms = t->mod;
+            lo = t->prelim + ms;
+            for (Node *n = next_left_contour(t); n; n = next_left_contour(n))
+            {
+                ms += n->mod;
+                if (n->prelim + ms < lo)
+                    lo = n->prelim + ms;
+            }
+            ms = t->mod;
+            hi = t->prelim + ms + breadth<O>(t);
+            for (Node *n = next_right_contour(t); n; n = next_right_contour(n))
+            {
+                ms += n->mod;
+                if (n->prelim + ms + breadth<O>(n) > hi)
+                    hi = n->prelim + ms + breadth<O>(n);
+            }
+        }
+
+        template <orientation O, TreeNode Node>
+        // secondwalk for radial mode: the breadth centre becomes an angle and
+        // the depth a radius, written straight into x,y.
+        constexpr void secondwalk_radial(Node *t, coord_t<Node> modsum, radial_sink<Node> &sink)
+        {
+            sink.push(t, double(t->prelim + modsum) + double(breadth<O>(t)) / 2, double(depth_pos<O>(t)));
+            compensated<coord_t<Node>> d, modsumdelta;
+            for (Node *c : t->children)
+            {
+                d.add(c->shift);
+                modsumdelta.add(d.value() + c->change);
+                coord_t<Node> mod = c->mod + modsumdelta.value();
+                c->mod = mod;
+                secondwalk_radial<O>(c, modsum + mod, sink);
+            }
+        }
+
+        // ─── two-sided layout ────────────────────────────────────────────
+
+        template <orientation O>
+        constexpr orientation mirrored = O == orientation::top_down     ? orientation::bottom_up
+                                         : O == orientation::bottom_up  ? orientation::top_down
+                                         : O == orientation::left_right ? orientation::right_left
+                                                                        : orientation::left_right;
+
+        template <TreeNode Node>
+        constexpr std::size_t subtree_size(Node *t)
+        {
+            std::size_t n = 0;
+            std::vector<Node *> stack{t};
+            while (!stack.empty())
+            {
+                Node *c = stack.back();
+                stack.pop_back();
+                ++n;
+                for (std::size_t i = 0; i < c->children.size(); ++i)
+                    stack.push_back(c->children[i]);
+            }
+            return n;
+        }
+
+        template <TreeNode Node>
+        // number of leading children that go to the first side, so that both
+        // sides hold about the same number of nodes.
+        constexpr std::size_t split_children(Node *t)
+        {
+            std::size_t n = t->children.size();
+            std::vector<std::size_t> prefix(n + 1, 0);
+            for (std::size_t i = 0; i < n; ++i)
+                prefix[i + 1] = prefix[i] + subtree_size(t->children[i]);
+            std::size_t best = n ? 1 : 0;
+            for (std::size_t k = best; k < n; ++k)
+            {
+                auto imbalance = [&](std::size_t j)
+                { return prefix[j] * 2 > prefix[n] ? prefix[j] * 2 - prefix[n] : prefix[n] - prefix[j] * 2; };
+                if (imbalance(k + 1) < imbalance(best))
+                    best = k + 1;
+            }
+            return best;
+        }
+
+        template <orientation O, TreeNode Node, typename Sep>
+        // firstwalk over the children [first, last) of t only, as if they were
+        // all of t's children. t itself is left untouched. `depth` is the
+        // children's level when laying out layered.
+        constexpr void firstwalk_range(Node *t, int first, int last, const std::vector<coord_t<Node>> *baseline, std::size_t depth, const Sep &sep)
+        {
+            auto walk = [&](Node *c)
+            {
+                if (baseline)
+                    firstwalk_layered<O>(c, *baseline, depth, sep);
+                else
+                    firstwalk<O>(c, sep);
+            };
+            // how deep a child subtree reaches, as firstwalk feeds the chain.
+            auto low = [&](Node *c, bool leftmost) -> coord_t<Node>
+            {
+                Node *e = iyl_extreme(c, leftmost);
+                return baseline ? coord_t<Node>(depth_pos<O>(e)) : bottom<O>(e);
+            };
+
+            walk(t->children[first]);
+            std::vector<IYL<coord_t<Node>>> ih;
+            updateIYL(low(t->children[first], true), first, ih);
+            for (int i = first + 1; i < last; ++i)
+            {
+                walk(t->children[i]);
+                coord_t<Node> minY = low(t->children[i], false);
+                if (baseline)
+                    separate_layered<O>(t, i, ih, first, sep);
+                else
+                    separate<O>(t, i, ih, first, sep);
+                updateIYL(minY, i, ih);
+            }
+
+            // centre the group on the root's breadth position 0.
+            coord_t<Node> off = -center_prelim<O>(t, first, last);
+            for (int i = first; i < last; ++i)
+                t->children[i]->mod += off;
+        }
+
+        template <orientation O, TreeNode Node>
+        // secondwalk of the children [first, last) of a two-sided root.
+        constexpr void secondwalk_range(Node *t, std::size_t first, std::size_t last)
+        {
+            coord_t<Node> d = 0, modsumdelta = 0;
+            for (std::size_t i = first; i < last; ++i)
+            {
+                Node *c = t->children[i];
+                d += c->shift;
+                modsumdelta += d + c->change;
+                c->mod += modsumdelta;
+                if constexpr (mixed_precision<Node>)
+                    secondwalk_mixed<O>(c, coord_t<Node>(t->mod) + c->mod);
+                else
+                    secondwalk<O>(c, t->mod);
+            }
+        }
+
+        template <orientation O, TreeNode Node, typename Sep>
+        // both halves are laid out from the same root in one pass each; the
+        // second half starts one root extent further back so that, once
+        // mirrored, it hangs off the root's opposite edge.
+        constexpr void run_two_sided(Node *t, const options &opt, const Sep &sep)
+        {
+            constexpr orientation M = mirrored<O>;
+            std::size_t k = split_children(t);
+            std::size_t n = t->children.size();
+            t->prelim = 0;
+            t->mod = 0;
+
+            std::vector<coord_t<Node>> baseline;
+            if (opt.layered)
+                baseline = level_baselines<O>(&t, 1);
+
+            depth_pos<O>(t) = 0;
+            if (k > 0)
+                firstwalk_range<O>(t, 0, int(k), opt.layered ? &baseline : nullptr, 1, sep);
+            depth_pos<O>(t) = -coord_t<Node>(extent<O>(t));
+            if (opt.layered)
+                for (coord_t<Node> &b : baseline)
+                    b -= extent<O>(t);
+            if (k < n)
+                firstwalk_range<M>(t, int(k), int(n), opt.layered ? &baseline : nullptr, 1, sep);
+
+            // the root is placed like secondwalk places any node, so it is
+            // mirrored too and both halves keep V_SPACING from its edges.
+            depth_pos<O>(t) = 0;
+            breadth_pos<O>(t) = 0;
+            mirror<O>(t);
+            secondwalk_range<O>(t, 0, k);
+            secondwalk_range<M>(t, k, n);
+        }
+
+        // ─── forest ──────────────────────────────────────────────────────
+
+        template <orientation O, TreeNode Node, typename Sep>
+        // the roots are the children of `virt`, an invisible parent they do
+        // not point back to; they are merged like siblings, so the trees
+        // interlock along their contours.
+        constexpr void run_forest(Node &virt, const options &opt, const Sep &sep)
+        {
+            int n = int(virt.children.size());
+            if (n == 0)
+                return;
+            std::vector<coord_t<Node>> baseline;
+            if (opt.layered)
+                baseline = level_baselines<O>(&virt.children[0], n);
+            firstwalk_range<O>(&virt, 0, n, opt.layered ? &baseline : nullptr, 0, sep);
+            secondwalk_range<O>(&virt, 0, n);
+        }
+
+        // ─── preview ─────────────────────────────────────────────────────
+
+        // one level of a subtree's outline: leftmost and rightmost breadth.
+        template <typename C>
+        struct span
+        {
+            C l, r;
+        };
+
+        // per-depth outline of a subtree, deepest level first so a parent
+        // pushes its own level at the back. stored values are relative to off.
+        // root is where the exact first walk puts the subtree's root: its
+        // offset from the end of its first-child chain.
+        template <typename C>
+        struct level_contour
+        {
+            std::vector<span<C>> lv;
+            C off = 0, root = 0;
+        };
+
+        template <typename C>
+        using span_pool = std::vector<std::vector<span<C>>>;
+
+        template <typename C>
+        // fold b, already placed, into acc. the taller outline is kept and
+        // the shared top levels take their outer side from the other one.
+        constexpr void merge_levels(level_contour<C> &acc, level_contour<C> &b, span_pool<C> &pool)
+        {
+            bool right_taller = b.lv.size() > acc.lv.size();
+            if (right_taller)
+                std::swap(acc, b);
+            std::size_t n = b.lv.size(), na = acc.lv.size();
+            for (std::size_t k = 0; k < n; ++k)
+            {
+                span<C> &a = acc.lv[na - 1 - k];
+                const span<C> &s = b.lv[n - 1 - k];
+                if (right_taller)
+                    a.l = s.l + b.off - acc.off;
+                else
+                    a.r = s.r + b.off - acc.off;
+            }
+            b.lv.clear();
+            pool.push_back(std::move(b.lv));
+        }
+
+        template <orientation O, TreeNode Node>
+        // bottom-up pass of the preview. leaves each child's breadth offset
+        // from its parent in prelim and the tallest node of every depth in
+        // heights. siblings only compare outlines level by level: no
+        // threads, and no spreading of the siblings in between.
+        constexpr level_contour<coord_t<Node>> preview_walk(Node *t, std::vector<coord_t<Node>> &heights, std::size_t depth, span_pool<coord_t<Node>> &pool)
+        {
+            using C = coord_t<Node>;
+            if (heights.size() <= depth)
+                heights.push_back(extent<O>(t));
+            else if (heights[depth] < extent<O>(t))
+                heights[depth] = extent<O>(t);
+
+            level_contour<C> acc;
+            if (t->children.empty())
+            {
+                if (!pool.empty())
+                {
+                    acc.lv = std::move(pool.back());
+                    pool.pop_back();
+                }
+            }
+            else
+            {
+                acc = preview_walk<O>(t->children[0], heights, depth + 1, pool);
+                C root0 = acc.root;
+                t->children[0]->prelim = 0;
+                for (std::size_t i = 1; i < t->children.size(); ++i)
+                {
+                    Node *c = t->children[i];
+                    level_contour<C> b = preview_walk<O>(c, heights, depth + 1, pool);
+                    // like the first walk, a subtree starts where its own
+                    // first walk left it and is only ever pushed right.
+                    C pos = b.root - root0;
+                    std::size_t n = acc.lv.size() < b.lv.size() ? acc.lv.size() : b.lv.size();
+                    for (std::size_t k = 0; k < n; ++k)
+                    {
+                        C need = (acc.lv[acc.lv.size() - 1 - k].r + acc.off + spacing<Node>(H_SPACING)) -
+                                 (b.lv[b.lv.size() - 1 - k].l + b.off);
+                        if (need > pos)
+                            pos = need;
+                    }
+                    c->prelim = pos;
+                    b.off += pos;
+                    merge_levels(acc, b, pool);
+                }
+
+                // centre t over its first and last child, as position_root does.
+                Node *f = t->children.front(), *l = t->children.back();
+                C mid;
+                if constexpr (std::is_integral_v<C>)
+                    mid = (C(f->prelim) + l->prelim + breadth<O>(l) - breadth<O>(t)) / 2;
+                else
+                    mid = (C(f->prelim) + l->prelim + breadth<O>(l)) / 2 - breadth<O>(t) / 2;
+                for (Node *c : t->children)
+                    c->prelim -= mid;
+                acc.off -= mid;
+                acc.root = root0 + mid;
+            }
+            acc.lv.push_back({-acc.off, C(breadth<O>(t)) - acc.off});
+            return acc;
+        }
+
+        template <orientation O, TreeNode Node>
+        // top-down pass of the preview: absolute breadth from the offsets,
+        // depth from the per-level baselines.
+        constexpr void preview_place(Node *t, coord_t<Node> pos, const std::vector<coord_t<Node>> &baseline, std::size_t depth)
+        {
+            breadth_pos<O>(t) = pos;
+            depth_pos<O>(t) = baseline[depth];
+            mirror<O>(t);
+            for (Node *c : t->children)
+                preview_place<O>(c, pos + c->prelim, baseline, depth + 1);
+        }
+
+        template <orientation O, TreeNode Node>
+        constexpr void run_preview(Node *t)
+        {
+            using C = coord_t<Node>;
+            std::vector<C> baseline;
+            span_pool<C> pool;
+            preview_walk<O>(t, baseline, 0, pool);
+            C y = 0;
+            for (C &l : baseline)
+            {
+                C h = l;
+                l = y;
+                y += h + spacing<Node>(V_SPACING);
+            }
+            // same frame as layout(): the end of the first-child chain at 0.
+            C pos = 0;
+            for (Node *n = t; !n->children.empty(); n = n->children[0])
+                pos -= n->children[0]->prelim;
+            preview_place<O>(t, pos, baseline, 0);
+        }
+
+        // calls f.template operator()<O>() for the runtime orientation o, so
+        // each orientation gets its own instantiation and the axis choice
+        // stays out of the hot loops.
+        template <typename F>
+        constexpr void with_orientation(orientation o, F &&f)
+        {
+            switch (o)
+            {
+            case orientation::top_down:
+                f.template operator()<orientation::top_down>();
+                break;
+            case orientation::bottom_up:
+                f.template operator()<orientation::bottom_up>();
+                break;
+            case orientation::left_right:
+                f.template operator()<orientation::left_right>();
+                break;
+            case orientation::right_left:
+                f.template operator()<orientation::right_left>();
+                break;
+            }
+        }
+
+        template <orientation O, TreeNode Node, typename Sep>
+        constexpr void run(Node *t, const options &opt, const Sep &sep)
+        {
+            if (opt.two_sided && !opt.radial)
+                return run_two_sided<O>(t, opt, sep);
+
+            if (opt.layered)
+                firstwalk_layered<O>(t, level_baselines<O>(&t, 1), 0, sep);
+            else
+                firstwalk<O>(t, sep);
+            secondwalk_root<O>(t, opt);
+        }
+
+        template <orientation O, TreeNode Node>
+        // second walk from the root once the first walk is done, in the
+        // variant the options and the node type ask for.
+        constexpr void secondwalk_root(Node *t, const options &opt)
+        {
+            if (opt.radial)
+            {
+                coord_t<Node> lo, hi;
+                breadth_range<O>(t, lo, hi);
+                radial_sink<Node> sink;
+                sink.start = double(lo);
+                // leave a sibling gap between the last and the first leaf.
+                sink.span = double(hi - lo) + double(spacing<Node>(H_SPACING));
+                secondwalk_radial<O>(t, /*modsum=*/coord_t<Node>(t->mod), sink);
+                sink.flush();
+            }
+            else if constexpr (mixed_precision<Node>)
+                secondwalk_mixed<O>(t, /*modsum=*/coord_t<Node>(t->mod));
+            else
+                secondwalk<O>(t, /*modsum=*/0);
+        }
+
     } // namespace details
 
+    /// fixed-point helpers for nodes with integer fields and `fraction_bits` F.
+    template <int F, std::integral I = std::int32_t>
+    constexpr I to_fixed(double v)
+    {
+        double s = v * double(std::int64_t(1) << F);
+        return I(s < 0 ? s - 0.5 : s + 0.5);
+    }
+
+    template <int F, std::integral I>
+    constexpr double from_fixed(I v)
+    {
+        return double(v) / double(std::int64_t(1) << F);
+    }
+
+    /// compute x,y for every node in the tree rooted at t, keeping the gaps
+    /// given by the separation policy sep (see constant_separation).
+    template <TreeNode Node, typename Sep>
+    constexpr void layout(Node *t, const options &opt, const Sep &sep)
+    {
+        details::with_orientation(opt.radial ? orientation::top_down : opt.orientation,
+                                  [&]<orientation O>()
+                                  { details::run<O>(t, opt, sep); });
+    }
+
     /// compute x,y for every node in the tree rooted at t.
     template <TreeNode Node>
-    void layout(Node *t)
+    constexpr void layout(Node *t, const options &opt)
+    {
+        layout(t, opt, constant_separation{});
+    }
+
+    template <TreeNode Node>
+    constexpr void layout(Node *t)
+    {
+        layout(t, options{});
+    }
+
+    /// fast approximate layout, for a first frame of very large trees.
+    /// siblings are packed by comparing their outlines depth by depth in a
+    /// single bottom-up pass (no threads, no level pre-pass), then one
+    /// top-down pass writes x,y.
+    ///
+    /// quality: the drawing is layered (see options::layered) and has the
+    /// same bounding box as layout(t, {.layered = true}), every node at the
+    /// same depth. x only differs where that layout spreads siblings evenly:
+    /// when a subtree is pushed away from a sibling further left, the
+    /// siblings in between stay where they were, so each of them is left of
+    /// its exact place by less than the distance of that push. nothing
+    /// overlaps. only opt.orientation is used; run layout() afterwards to
+    /// refine. siblings are compared by outline, not node by node, so only
+    /// constant_separation is supported.
+    template <TreeNode Node, typename Sep = constant_separation>
+    constexpr void preview(Node *t, const options &opt = {}, const Sep & = {})
+    {
+        static_assert(std::is_same_v<Sep, constant_separation>, "preview only supports constant_separation");
+        details::with_orientation(opt.orientation,
+                                  [&]<orientation O>()
+                                  { details::run_preview<O>(t); });
+    }
+
+    /// lay out n separate trees side by side, packed as tightly as their
+    /// contours allow (as siblings under an invisible parent) and centred on
+    /// breadth 0. Node must be default constructible and its children must
+    /// support push_back, for that invisible parent. radial and two_sided
+    /// are ignored.
+    template <TreeNode Node, typename Sep = constant_separation>
+        requires std::default_initializable<Node> && requires(Node n, Node *c) { n.children.push_back(c); }
+    constexpr void layout_forest(Node *const *roots, std::size_t n, const options &opt = {}, const Sep &sep = {})
     {
-        details::firstwalk(t);
-        details::secondwalk(t, /*modsum=*/0);
+        Node virt{};
+        virt.w = virt.h = 0;
+        virt.prelim = virt.mod = 0;
+        for (std::size_t i = 0; i < n; ++i)
+            virt.children.push_back(roots[i]);
+        details::with_orientation(opt.orientation,
+                                  [&]<orientation O>()
+                                  { details::run_forest<O>(virt, opt, sep); });
     }
 
 } // namespace layout
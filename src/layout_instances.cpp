@@ -0,0 +1,4 @@
+#include "layout_instances.hpp"
+
+TIDY_TREE_INSTANTIATE_LAYOUT(layout::basic_node<double>)
+TIDY_TREE_INSTANTIATE_LAYOUT(layout::basic_node<float>)
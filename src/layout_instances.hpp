@@ -0,0 +1,42 @@
+/**
+ *
+ * precompiled layout entry points.
+ *
+ * layout::layout is a constexpr template, and constexpr functions are
+ * instantiated wherever they are used, even behind `extern template`. to
+ * keep firstwalk/separate/... from being instantiated in every translation
+ * unit, TIDY_TREE_DECLARE_LAYOUT(Node) declares a plain, non-template
+ * overload `layout::layout(Node *)`. overload resolution prefers it over
+ * the template, so including translation units only see a declaration.
+ * TIDY_TREE_INSTANTIATE_LAYOUT(Node) goes in exactly one .cpp and defines
+ * it from the template.
+ *
+ * the tidy_tree_instances library does this for basic_node<double> and
+ * basic_node<float>. use the same pair of macros for your own node type.
+ *
+ * in constant evaluation name the template explicitly: layout::layout<Node>(t).
+ *
+ */
+
+#pragma once
+#include "layout.hpp"
+#include "basic_node.hpp"
+
+// both macros must be used at global scope with a fully qualified type.
+#define TIDY_TREE_DECLARE_LAYOUT(...)   \
+    namespace layout                    \
+    {                                   \
+        void layout(__VA_ARGS__ *t);    \
+    }
+
+#define TIDY_TREE_INSTANTIATE_LAYOUT(...) \
+    namespace layout                      \
+    {                                     \
+        void layout(__VA_ARGS__ *t)       \
+        {                                 \
+            layout<__VA_ARGS__>(t);       \
+        }                                 \
+    }
+
+TIDY_TREE_DECLARE_LAYOUT(layout::basic_node<double>)
+TIDY_TREE_DECLARE_LAYOUT(layout::basic_node<float>)
@@ -0,0 +1,205 @@
+/**
+ *
+ * layout of trees that are materialized on demand.
+ *
+ * the tree starts as its root alone. children are fetched from a provider
+ * the first time a node is expanded; until then the node is drawn as a
+ * leaf with the provider's placeholder size. after every expand/collapse
+ * only the changed region is laid out again: the path from the changed
+ * node to the root, with every untouched subtree next to it merged as its
+ * cached contour envelope (see lod_layout.hpp). an untouched subtree keeps
+ * its shape, so its nodes are just moved by the offset its root moved by.
+ *
+ * positions match a full layout::layout() of the materialized tree
+ * exactly for integral (fixed-point) coordinates, and up to rounding for
+ * floating point ones. like lod::layout, it always uses
+ * constant_separation.
+ *
+ */
+
+#pragma once
+#include "layout.hpp"
+#include "lod_layout.hpp"
+#include <vector>
+#include <deque>
+#include <cstddef>
+#include <concepts>
+
+namespace layout
+{
+    namespace lazy
+    {
+        // —————————————————————————————————————————————————————
+        // a node's size, as the provider reports it.
+        struct dimensions
+        {
+            double w, h;
+        };
+
+        // source of the tree. children(k, out) appends the keys of k's
+        // children to out; size(k, expanded) is the node's size, where
+        // expanded == false asks for the placeholder drawn while its
+        // children are not shown.
+        template <typename P>
+        concept child_provider = std::default_initializable<typename P::key_type> &&
+                                 requires(P &p, const typename P::key_type &k, std::vector<typename P::key_type> &out) {
+                                     p.children(k, out);
+                                     { p.size(k, true) } -> std::convertible_to<dimensions>;
+                                 };
+
+        template <typename Key, typename T = double>
+        struct node
+        {
+            std::vector<node *> children; // shown children, empty while collapsed
+            node *parent = nullptr;
+            T x = 0, y = 0, w = 0, h = 0;
+            T prelim = 0, mod = 0, shift = 0, change = 0;
+            node *tl = nullptr, *tr = nullptr;
+            node *el = nullptr, *er = nullptr;
+            T msel = 0, mser = 0;
+
+            Key key{};
+            std::vector<node *> hidden; // children kept while collapsed
+            bool fetched = false;       // children asked from the provider
+            bool dirty = false;         // on the path being laid out again
+        };
+
+        template <child_provider P, typename T = double>
+        class tree
+        {
+        public:
+            using key_type = typename P::key_type;
+            using node_type = node<key_type, T>;
+
+            tree(P &provider, key_type root, const options &opt = {})
+                : provider_(provider), opt_(opt)
+            {
+                cache_.use(opt_.orientation);
+                node_type *r = make(std::move(root), nullptr);
+                relayout(r);
+            }
+
+            node_type *root() { return &nodes_.front(); }
+
+            // materialized nodes, shown or not.
+            std::size_t size() const { return nodes_.size(); }
+
+            bool expanded(const node_type *n) const { return !n->children.empty(); }
+
+            // n is drawn: every ancestor is expanded.
+            bool shown(const node_type *n) const
+            {
+                for (; n->parent; n = n->parent)
+                    if (n->parent->children.empty())
+                        return false;
+                return true;
+            }
+
+            // show n's children, fetching them on first use, and lay out the
+            // affected region. false if n has no children, or if n is
+            // hidden under a collapsed ancestor: it has no position to lay
+            // its children out from, so nothing is changed.
+            bool expand(node_type *n)
+            {
+                if (!n->children.empty())
+                    return true;
+                if (!shown(n))
+                    return false;
+                if (!n->fetched)
+                {
+                    n->fetched = true;
+                    std::vector<key_type> keys;
+                    provider_.children(n->key, keys);
+                    for (key_type &k : keys)
+                        n->hidden.push_back(make(std::move(k), n));
+                }
+                if (n->hidden.empty())
+                    return false;
+                n->children.swap(n->hidden);
+                resize(n, true);
+                relayout(n);
+                return true;
+            }
+
+            // hide n's children again; they stay materialized. false, and
+            // nothing changed, if n is not expanded or is itself hidden.
+            bool collapse(node_type *n)
+            {
+                if (n->children.empty() || !shown(n))
+                    return false;
+                n->hidden.swap(n->children);
+                resize(n, false);
+                relayout(n);
+                return true;
+            }
+
+        private:
+            node_type *make(key_type k, node_type *parent)
+            {
+                node_type &n = nodes_.emplace_back();
+                n.key = std::move(k);
+                n.parent = parent;
+                resize(&n, false);
+                return &n;
+            }
+
+            void resize(node_type *n, bool expanded)
+            {
+                dimensions s = provider_.size(n->key, expanded);
+                n->w = T(s.w);
+                n->h = T(s.h);
+            }
+
+            static void translate(node_type *t, T dx, T dy)
+            {
+                for (node_type *c : t->children)
+                {
+                    c->x += dx;
+                    c->y += dy;
+                    translate(c, dx, dy);
+                }
+            }
+
+            // lay out the path from changed to the root. the other children
+            // of path nodes are cut, so they come from the envelope cache,
+            // and afterwards their subtrees follow their roots.
+            void relayout(node_type *changed)
+            {
+                cache_.invalidate(changed);
+                for (node_type *t = changed; t; t = t->parent)
+                    t->dirty = true;
+
+                struct moved
+                {
+                    node_type *n;
+                    T x, y;
+                };
+                std::vector<moved> roots;
+                for (node_type *t = changed; t; t = t->parent)
+                    for (node_type *c : t->children)
+                        if (!c->dirty && !c->children.empty())
+                            roots.push_back({c, c->x, c->y});
+
+                layout::details::with_orientation(opt_.orientation,
+                                                  [&]<orientation O>()
+                                                  {
+                                                      auto cut = [](node_type *n, std::size_t)
+                                                      { return !n->dirty; };
+                                                      lod::details::run<O>(root(), cut, cache_);
+                                                  });
+
+                for (const moved &m : roots)
+                    if (m.n->x != m.x || m.n->y != m.y)
+                        translate(m.n, m.n->x - m.x, m.n->y - m.y);
+                for (node_type *t = changed; t; t = t->parent)
+                    t->dirty = false;
+            }
+
+            P &provider_;
+            options opt_;
+            std::deque<node_type> nodes_; // stable addresses
+            lod::cache<node_type> cache_;
+        };
+
+    } // namespace lazy
+} // namespace layout
@@ -0,0 +1,357 @@
+/**
+ *
+ * level-of-detail layout: lay out only the top of a tree.
+ *
+ * a subtree below the cut is replaced by its contour envelope, the chains
+ * of nodes the first walk would visit along its left and right sides,
+ * together with the mods and prelims it found there. the envelope of a
+ * subtree does not depend on anything outside it, so it is computed once,
+ * kept in a cache and reused by every later overview. merging an envelope
+ * takes the same steps, in the same order, as merging the real subtree, so
+ * every shown node gets exactly the position the full layout gives it
+ * (for floating point sizes: as long as depths add up exactly, which is
+ * the case for integral sizes).
+ *
+ * the layout runs on a shadow copy of the shown nodes, and envelopes are
+ * computed on a copy of the cut subtree, so no field of a node below the
+ * cut is ever written; those nodes keep whatever x,y they had.
+ *
+ * honours options::orientation; layered, two_sided and radial are not
+ * supported in this mode and are rejected by an assert.
+ *
+ */
+
+#pragma once
+#include "layout.hpp"
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+
+namespace layout
+{
+    namespace lod
+    {
+        // —————————————————————————————————————————————————————
+        // where to cut: a shown node's children are hidden once it is at
+        // max_depth, or when each of them would be drawn smaller than
+        // min_size: the widest child's breadth times scale (its size on
+        // screen) is below it.
+        struct criteria
+        {
+            std::size_t max_depth = SIZE_MAX;
+            double scale = 1.0;
+            double min_size = 0.0;
+        };
+
+        // contour envelope of a subtree, relative to its root.
+        template <TreeNode Node>
+        struct envelope
+        {
+            using C = details::coord_t<Node>;
+            using F = details::field_t<Node>;
+
+            struct step
+            {
+                C prelim, mod;
+                C depth; // depth_pos relative to the subtree root
+                F w, h;
+            };
+
+            C prelim = 0, msel = 0, mser = 0;
+            std::vector<step> left, right;
+        };
+
+        // envelopes by subtree root. they are only valid for the orientation
+        // they were computed in, so changing orientation empties the cache.
+        // call invalidate() when a subtree changes shape or sizes.
+        template <TreeNode Node>
+        class cache
+        {
+        public:
+            const envelope<Node> *find(const Node *t) const
+            {
+                auto it = map_.find(t);
+                return it == map_.end() ? nullptr : &it->second;
+            }
+
+            envelope<Node> &insert(const Node *t) { return map_[t]; }
+
+            // drop t and every ancestor, whose envelopes contain t's.
+            void invalidate(const Node *t)
+            {
+                for (; t; t = t->parent)
+                    map_.erase(t);
+            }
+
+            void clear() { map_.clear(); }
+            std::size_t size() const { return map_.size(); }
+
+            // empties the cache if it was filled for another orientation.
+            void use(orientation o)
+            {
+                if (o != orientation_)
+                    map_.clear();
+                orientation_ = o;
+            }
+
+        private:
+            std::unordered_map<const Node *, envelope<Node>> map_;
+            orientation orientation_ = orientation::top_down;
+        };
+
+        namespace details
+        {
+            using namespace layout::details;
+
+            // a bare copy of the subtree at t: sizes and shape only, in
+            // preorder, so copy[0] stands for t.
+            template <TreeNode Node>
+            std::size_t count(const Node *t)
+            {
+                std::size_t n = 1;
+                for (const Node *c : t->children)
+                    n += count(c);
+                return n;
+            }
+
+            template <TreeNode Node>
+            std::size_t copy(const Node *t, std::vector<Node> &out, std::size_t k, Node *parent)
+            {
+                Node &n = out[k];
+                n.w = t->w;
+                n.h = t->h;
+                n.parent = parent;
+                std::size_t next = k + 1;
+                for (const Node *c : t->children)
+                {
+                    n.children.push_back(&out[next]);
+                    next = copy(c, out, next, &n);
+                }
+                return next;
+            }
+
+            // record the contours a first walk of t left behind, before any
+            // ancestor threads into them.
+            template <orientation O, TreeNode Node>
+            void record(Node *t, envelope<Node> &e)
+            {
+                coord_t<Node> d = depth_pos<O>(t);
+                e.prelim = t->prelim;
+                e.msel = t->msel;
+                e.mser = t->mser;
+                e.left.clear();
+                e.right.clear();
+                for (Node *n = next_left_contour(t); n; n = next_left_contour(n))
+                    e.left.push_back({n->prelim, n->mod, coord_t<Node>(depth_pos<O>(n)) - d, n->w, n->h});
+                for (Node *n = next_right_contour(t); n; n = next_right_contour(n))
+                    e.right.push_back({n->prelim, n->mod, coord_t<Node>(depth_pos<O>(n)) - d, n->w, n->h});
+            }
+
+            // first walk of a copy of the subtree at t, then record its
+            // contours. the walk writes prelims, mods, threads and depths;
+            // doing it on the copy leaves every real node below the cut as
+            // it was. the copy lives only for this call.
+            template <orientation O, TreeNode Node>
+            void summarize(const Node *t, envelope<Node> &e)
+            {
+                std::vector<Node> sub(count(t));
+                copy(t, sub, 0, static_cast<Node *>(nullptr));
+                firstwalk<O>(&sub[0]);
+                record<O>(&sub[0], e);
+            }
+
+            // the shown part of the tree, mirrored in `shadow`. shadow[k]
+            // stands for real[k]; a cut node's shadow is a leaf threaded to
+            // proxies of its envelope, stored after all the shown nodes.
+            template <TreeNode Node>
+            struct shadow_tree
+            {
+                std::vector<Node *> real;
+                std::vector<const envelope<Node> *> cut;
+                std::vector<Node> shadow;
+            };
+
+            template <orientation O, TreeNode Node>
+            // breadth of the widest child of t, what min_size is tested on.
+            coord_t<Node> widest_child(const Node *t)
+            {
+                coord_t<Node> b = 0;
+                for (const Node *c : t->children)
+                    b = std::max(b, coord_t<Node>(breadth<O>(c)));
+                return b;
+            }
+
+            template <orientation O, TreeNode Node, typename Cut>
+            void collect(Node *t, std::size_t depth, const Cut &cut, cache<Node> &ch, shadow_tree<Node> &s, std::size_t &proxies)
+            {
+                s.real.push_back(t);
+                s.cut.push_back(nullptr);
+                if (t->children.empty())
+                    return;
+                if (cut(t, depth))
+                {
+                    const envelope<Node> *e = ch.find(t);
+                    if (!e)
+                    {
+                        envelope<Node> &ne = ch.insert(t);
+                        summarize<O>(t, ne);
+                        e = &ne;
+                    }
+                    s.cut.back() = e;
+                    proxies += e->left.size() + e->right.size();
+                    return;
+                }
+                for (Node *k : t->children)
+                    collect<O>(k, depth + 1, cut, ch, s, proxies);
+            }
+
+            template <TreeNode Node>
+            // shadow[k] gets real[k]'s sizes and the shadows of its children,
+            // which follow it in preorder. returns the index after its subtree.
+            std::size_t link(shadow_tree<Node> &s, std::size_t k, Node *parent)
+            {
+                Node &n = s.shadow[k];
+                n.w = s.real[k]->w;
+                n.h = s.real[k]->h;
+                n.parent = parent;
+                std::size_t next = k + 1;
+                if (!s.cut[k])
+                    for (std::size_t i = 0; i < s.real[k]->children.size(); ++i)
+                    {
+                        n.children.push_back(&s.shadow[next]);
+                        next = link(s, next, &n);
+                    }
+                return next;
+            }
+
+            template <orientation O, TreeNode Node>
+            // hang the proxies of e off the leaf t, as firstwalk would have left them.
+            void attach(Node *t, const envelope<Node> &e, Node *proxies)
+            {
+                using C = coord_t<Node>;
+                auto chain = [&](const std::vector<typename envelope<Node>::step> &steps, Node *Node::*next)
+                {
+                    Node *prev = t;
+                    for (const auto &st : steps)
+                    {
+                        Node *p = proxies++;
+                        p->w = st.w;
+                        p->h = st.h;
+                        p->prelim = st.prelim;
+                        p->mod = st.mod;
+                        depth_pos<O>(p) = C(depth_pos<O>(t)) + st.depth;
+                        p->el = p->er = p;
+                        prev->*next = p;
+                        prev = p;
+                    }
+                    return prev;
+                };
+                t->prelim = e.prelim;
+                t->el = chain(e.left, &Node::tl);
+                t->er = chain(e.right, &Node::tr);
+                t->msel = e.msel;
+                t->mser = e.mser;
+            }
+
+            template <orientation O, TreeNode Node>
+            // firstwalk over the shadow, with the envelopes standing in for
+            // the cut subtrees. `proxies` is advanced past the ones used.
+            void firstwalk_shadow(shadow_tree<Node> &s, Node *t, Node *&proxies)
+            {
+                std::size_t k = std::size_t(t - s.shadow.data());
+                if (t->parent)
+                    depth_pos<O>(t) = depth_pos<O>(t->parent) + extent<O>(t->parent) + spacing<Node>(V_SPACING);
+                else
+                    depth_pos<O>(t) = 0;
+
+                if (s.cut[k])
+                {
+                    attach<O>(t, *s.cut[k], proxies);
+                    proxies += s.cut[k]->left.size() + s.cut[k]->right.size();
+                    return;
+                }
+                if (t->children.empty())
+                {
+                    set_extremes(t);
+                    return;
+                }
+
+                firstwalk_shadow<O>(s, t->children[0], proxies);
+                std::vector<IYL<coord_t<Node>>> ih;
+                updateIYL(bottom<O>(iyl_extreme(t->children[0], true)), 0, ih);
+
+                for (int i = 1; i < (int)t->children.size(); ++i)
+                {
+                    firstwalk_shadow<O>(s, t->children[i], proxies);
+                    coord_t<Node> minY = bottom<O>(iyl_extreme(t->children[i], false));
+                    separate<O>(t, i, ih);
+                    updateIYL(minY, i, ih);
+                }
+
+                position_root<O>(t);
+                set_extremes(t);
+            }
+
+            template <orientation O, TreeNode Node, typename Cut>
+            // lay out the tree at root down to the nodes for which
+            // cut(node, depth) holds; their subtrees are merged as envelopes.
+            void run(Node *root, const Cut &cut, cache<Node> &ch)
+            {
+                shadow_tree<Node> s;
+                std::size_t proxies = 0;
+                collect<O>(root, 0, cut, ch, s, proxies);
+                std::size_t shown = s.real.size();
+
+                // sized once up front: the shadows point at each other.
+                s.shadow.resize(shown + proxies);
+                link(s, 0, static_cast<Node *>(nullptr));
+                Node *next = s.shadow.data() + shown;
+                firstwalk_shadow<O>(s, &s.shadow[0], next);
+
+                if constexpr (mixed_precision<Node>)
+                    secondwalk_mixed<O>(&s.shadow[0], coord_t<Node>(s.shadow[0].mod));
+                else
+                    secondwalk<O>(&s.shadow[0], 0);
+
+                for (std::size_t k = 0; k < shown; ++k)
+                {
+                    s.real[k]->x = s.shadow[k].x;
+                    s.real[k]->y = s.shadow[k].y;
+                }
+            }
+
+        } // namespace details
+
+        /// lay out the part of the tree rooted at t that c leaves visible.
+        /// shown nodes get the same x,y as layout::layout(t, opt) would give
+        /// them; hidden ones are not written. envelopes of the cut subtrees
+        /// are taken from ch or computed (one pass over the subtree) and
+        /// added to it. Node must be default constructible and its children
+        /// must support push_back, for the shadow copy.
+        ///
+        /// opt.layered, opt.two_sided and opt.radial must be false (asserted).
+        /// only constant_separation is supported: cached envelopes are
+        /// shared by every call, and merging them compares proxies, not
+        /// the real contour nodes a policy would be asked about.
+        template <TreeNode Node, typename Sep = constant_separation>
+            requires std::default_initializable<Node> && requires(Node n, Node *c) { n.children.push_back(c); }
+        void layout(Node *t, cache<Node> &ch, const criteria &c, const options &opt = {}, const Sep & = {})
+        {
+            static_assert(std::is_same_v<Sep, constant_separation>, "lod::layout only supports constant_separation");
+            assert(!opt.layered && !opt.two_sided && !opt.radial && "lod::layout only supports plain layouts");
+            ch.use(opt.orientation);
+            layout::details::with_orientation(opt.orientation,
+                                              [&]<orientation O>()
+                                              {
+                                                  auto cut = [&](Node *n, std::size_t depth)
+                                                  { return depth >= c.max_depth || double(details::widest_child<O>(n)) * c.scale < c.min_size; };
+                                                  details::run<O>(t, cut, ch);
+                                              });
+        }
+
+    } // namespace lod
+} // namespace layout
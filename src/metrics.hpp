@@ -0,0 +1,296 @@
+/**
+ *
+ * subtree metrics: size, height, depth and leaf count of every node.
+ *
+ * the metrics are kept in a side table indexed by preorder id, so the nodes
+ * themselves need no extra fields. a subtree occupies a contiguous id range,
+ * which is what makes the table cheap to walk top-down: a node's first child
+ * is the next id, and its next sibling is its id plus its size.
+ *
+ * the top of the tree is split into parts, runs of consecutive sibling
+ * subtrees of up to a node budget each, a few dozen per thread. their
+ * sizes are counted first, so every part is then swept (one preorder pass
+ * that adds each finished node to its parent) straight into its preorder
+ * range of the table, in parallel; only the nodes above them are handled
+ * on the calling thread. a wide root with a million leaves makes a few
+ * dozen parts per thread, not a million, and nothing is copied.
+ *
+ */
+
+#pragma once
+#include "layout.hpp"
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace layout
+{
+    namespace metrics
+    {
+        // —————————————————————————————————————————————————————
+        // height counts edges (a leaf has height 0), depth is the distance
+        // to the root of the pass, size counts the node itself. 32 bits
+        // each, so trees up to 2^32 - 1 nodes.
+        struct subtree
+        {
+            std::uint32_t size, height, depth, leaves;
+        };
+
+        template <TreeNode Node>
+        class table;
+
+        template <TreeNode Node>
+        void compute(Node *root, table<Node> &out, unsigned threads = 0);
+
+        namespace details
+        {
+            using namespace layout::details;
+
+            // a run of consecutive siblings, frontier[first, last), swept as
+            // one piece into ids [offset, offset + size) of the table.
+            struct part
+            {
+                std::size_t first, last;
+                std::size_t size;
+                std::size_t offset;
+            };
+
+            template <TreeNode Node>
+            // nodes in the subtree at t.
+            std::size_t count(Node *t)
+            {
+                std::size_t n = 0;
+                std::vector<Node *> stack{t};
+                while (!stack.empty())
+                {
+                    Node *c = stack.back();
+                    stack.pop_back();
+                    ++n;
+                    stack.insert(stack.end(), c->children.begin(), c->children.end());
+                }
+                return n;
+            }
+
+            template <TreeNode Node>
+            // one depth-first pass over the subtree at root, which gets id
+            // first: ids are handed out on the way down, and a finished node
+            // is added to its parent on the way up.
+            void sweep(Node *root, std::uint32_t depth, std::size_t first, Node **nodes, subtree *m)
+            {
+                struct frame
+                {
+                    Node *n;
+                    std::size_t next; // child to visit next
+                    std::size_t v;
+                };
+                std::size_t id = first;
+                auto enter = [&](Node *n, std::uint32_t d)
+                {
+                    nodes[id] = n;
+                    m[id] = {1, 0, d, n->children.empty() ? 1u : 0u};
+                    return frame{n, 0, id++};
+                };
+
+                std::vector<frame> stack{enter(root, depth)};
+                while (!stack.empty())
+                {
+                    frame &f = stack.back();
+                    if (f.next < f.n->children.size())
+                    {
+                        Node *c = f.n->children[f.next++];
+                        stack.push_back(enter(c, m[f.v].depth + 1));
+                        continue;
+                    }
+                    const subtree done = m[f.v];
+                    stack.pop_back();
+                    if (stack.empty())
+                        break;
+                    subtree &u = m[stack.back().v];
+                    u.size += done.size;
+                    u.height = std::max(u.height, done.height + 1);
+                    u.leaves += done.leaves;
+                }
+            }
+
+            template <typename F>
+            void run_parallel(std::size_t tasks, unsigned threads, const F &f)
+            {
+                std::atomic<std::size_t> next{0};
+                auto work = [&]
+                {
+                    for (std::size_t k; (k = next++) < tasks;)
+                        f(k);
+                };
+                std::vector<std::thread> pool;
+                for (unsigned k = 1; k < threads && k < tasks; ++k)
+                    pool.emplace_back(work);
+                work();
+                for (std::thread &th : pool)
+                    th.join();
+            }
+
+        } // namespace details
+
+        // metrics of a tree, indexed by preorder id; id 0 is the root.
+        template <TreeNode Node>
+        class table
+        {
+        public:
+            std::size_t size() const { return nodes_.size(); }
+
+            Node *node(std::size_t v) const { return nodes_[v]; }
+            const subtree &operator[](std::size_t v) const { return m_[v]; }
+
+            // preorder navigation: the first child of v (if any) is v + 1.
+            std::size_t next_sibling(std::size_t v) const { return v + m_[v].size; }
+
+            // id of n, found by walking down from the root along n's
+            // ancestors; size() if n is not in the table. costs the
+            // children passed over on the way.
+            std::size_t find(const Node *n) const
+            {
+                if (nodes_.empty())
+                    return size();
+                std::vector<const Node *> path;
+                for (; n && n != nodes_[0]; n = n->parent)
+                    path.push_back(n);
+                if (!n)
+                    return size();
+                std::size_t v = 0;
+                for (std::size_t k = path.size(); k-- > 0;)
+                {
+                    std::size_t c = v + 1;
+                    for (const Node *s : nodes_[v]->children)
+                    {
+                        if (s == path[k])
+                            break;
+                        c = next_sibling(c);
+                    }
+                    v = c;
+                }
+                return v;
+            }
+
+        private:
+            friend void compute<Node>(Node *root, table &out, unsigned threads);
+
+            std::vector<Node *> nodes_;
+            std::vector<subtree> m_;
+        };
+
+        /// fill out with the metrics of the tree at root, sweeping subtrees
+        /// on up to `threads` threads (0: one per hardware thread).
+        template <TreeNode Node>
+        void compute(Node *root, table<Node> &out, unsigned threads)
+        {
+            if (threads == 0)
+                threads = std::thread::hardware_concurrency();
+
+            // split the top of the tree, level by level, until there are
+            // enough subtrees to keep every thread busy.
+            std::vector<Node *> top, frontier{root};
+            std::uint32_t depth = 0; // of the frontier
+            std::size_t want = threads > 1 ? std::size_t(threads) * 32 : 1;
+            while (frontier.size() < want)
+            {
+                std::vector<Node *> below;
+                for (Node *n : frontier)
+                    below.insert(below.end(), n->children.begin(), n->children.end());
+                if (below.empty())
+                    break;
+                top.insert(top.end(), frontier.begin(), frontier.end());
+                frontier.swap(below);
+                ++depth;
+            }
+
+            // subtree sizes of the frontier, counted in parallel over runs
+            // of it.
+            std::vector<std::size_t> sizes(frontier.size());
+            std::size_t runs = std::min(frontier.size(), want);
+            details::run_parallel(runs, threads, [&](std::size_t k)
+                                  {
+                                      for (std::size_t i = frontier.size() * k / runs; i < frontier.size() * (k + 1) / runs; ++i)
+                                          sizes[i] = details::count(frontier[i]);
+                                  });
+            std::size_t below = 0;
+            for (std::size_t z : sizes)
+                below += z;
+
+            // consecutive siblings share a part up to the budget; a bigger
+            // subtree is a part of its own.
+            std::size_t budget = std::max<std::size_t>(1, (below + want - 1) / want);
+            std::vector<details::part> parts;
+            for (std::size_t i = 0; i < frontier.size(); ++i)
+            {
+                if (!parts.empty() && frontier[i]->parent == frontier[parts.back().first]->parent &&
+                    parts.back().size + sizes[i] <= budget)
+                {
+                    parts.back().last = i + 1;
+                    parts.back().size += sizes[i];
+                }
+                else
+                    parts.push_back({i, i + 1, sizes[i], 0});
+            }
+
+            // lay the top nodes and parts out in preorder. frontier nodes
+            // come in frontier order, and a part's roots one after another,
+            // so the first of them claims the whole part's range.
+            out.nodes_.resize(top.size() + below);
+            out.m_.resize(top.size() + below);
+
+            std::vector<std::size_t> top_ids;
+            std::size_t next = 0, seen = 0, part = 0;
+            std::vector<std::pair<Node *, std::uint32_t>> stack{{root, 0}};
+            while (!stack.empty())
+            {
+                auto [t, d] = stack.back();
+                stack.pop_back();
+                if (d == depth)
+                {
+                    if (part < parts.size() && parts[part].first == seen)
+                    {
+                        parts[part].offset = next;
+                        next += parts[part++].size;
+                    }
+                    ++seen;
+                    continue;
+                }
+                top_ids.push_back(next);
+                out.nodes_[next] = t;
+                out.m_[next] = {1, 0, d, t->children.empty() ? 1u : 0u};
+                ++next;
+                for (std::size_t k = t->children.size(); k-- > 0;)
+                    stack.push_back({t->children[k], d + 1});
+            }
+
+            details::run_parallel(parts.size(), threads, [&](std::size_t k)
+                                  {
+                                      const details::part &p = parts[k];
+                                      std::size_t v = p.offset;
+                                      for (std::size_t i = p.first; i < p.last; ++i)
+                                      {
+                                          details::sweep(frontier[i], depth, v, out.nodes_.data(), out.m_.data());
+                                          v += sizes[i];
+                                      }
+                                  });
+
+            // top nodes bottom-up: in reverse preorder, each one's children
+            // (top or part roots) are already final.
+            for (std::size_t k = top_ids.size(); k-- > 0;)
+            {
+                std::size_t v = top_ids[k];
+                subtree &u = out.m_[v];
+                for (std::size_t c = v + 1, i = 0; i < out.nodes_[v]->children.size(); ++i, c = out.next_sibling(c))
+                {
+                    u.size += out.m_[c].size;
+                    u.height = std::max(u.height, out.m_[c].height + 1);
+                    u.leaves += out.m_[c].leaves;
+                }
+            }
+        }
+
+    } // namespace metrics
+} // namespace layout
@@ -0,0 +1,431 @@
+/**
+ *
+ * Newick reader that builds trees ready for layout::layout, straight from
+ * the file's bytes.
+ *
+ * the file is mapped (text_input.hpp), not read, and labels are views into
+ * the mapping, so no text is copied. nodes are stored in one array in preorder
+ * and every node's children are a span into one shared child array (CSR
+ * style): a group of children is appended in one go when its ')' is read.
+ * the node array is sized up front from a count of '(' and ',' up to the
+ * tree's ';', so it never moves while the tree is built.
+ *
+ * node sizes come from the labels (label_size), or from any callable
+ * size(label, preorder index) returning a node_size.
+ *
+ *   layout::mapped_file f("trees.nwk");
+ *   layout::newick::reader r(f.text());
+ *   layout::newick::tree<> t;
+ *   while (r.next(t))
+ *       layout::layout(t.root());
+ *
+ * pipeline() does the same with parsing on a second thread, one tree ahead
+ * of the layout.
+ *
+ * accepted: labels (quoted or not), branch lengths, [comments] and white
+ * space between tokens, several trees per file. quoted labels keep their
+ * text as written, so an escaped quote stays doubled; underscores are not
+ * turned into blanks.
+ *
+ * the parser takes any std::string_view; mapped_file (text_input.hpp) is
+ * one way to get one.
+ *
+ */
+
+#pragma once
+#include "layout.hpp"
+#include "text_input.hpp"
+#include <vector>
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <thread>
+
+namespace layout
+{
+    namespace newick
+    {
+        // —————————————————————————————————————————————————————
+        struct node_size
+        {
+            double w, h;
+        };
+
+        /// sizes from the label: char_width per character plus padding,
+        /// so unlabelled nodes are padding wide.
+        struct label_size
+        {
+            double char_width = 7, height = 16, padding = 4;
+
+            node_size operator()(std::string_view label, std::size_t) const
+            {
+                return {padding + char_width * double(label.size()), height};
+            }
+        };
+
+        template <typename S>
+        concept SizeSource = requires(const S &s, std::string_view label, std::size_t v) {
+            { s(label, v) } -> std::convertible_to<node_size>;
+        };
+
+        template <typename T = double>
+        struct node
+        {
+            std::span<node *> children; // into the tree's child array
+            node *parent = nullptr;
+            T x = 0, y = 0, w = 0, h = 0;
+            T prelim = 0, mod = 0, shift = 0, change = 0;
+            node *tl = nullptr, *tr = nullptr;
+            node *el = nullptr, *er = nullptr;
+            T msel = 0, mser = 0;
+            std::string_view label; // into the text, without the quotes
+            double length = 0;      // branch length, 0 if not given
+        };
+
+        class reader;
+
+        // one parsed tree: its nodes in preorder (root first) and the
+        // arrays their children point into. movable, not copyable. reusing
+        // a tree for the next parse keeps its memory.
+        template <typename T = double>
+        class tree
+        {
+        public:
+            using node_type = node<T>;
+
+            tree() = default;
+            tree(tree &&) = default;
+            tree &operator=(tree &&) = default;
+            tree(const tree &) = delete;
+            tree &operator=(const tree &) = delete;
+
+            node_type *root() { return nodes_.empty() ? nullptr : nodes_.data(); }
+            std::size_t size() const { return nodes_.size(); }
+            node_type &operator[](std::size_t v) { return nodes_[v]; }
+            const node_type &operator[](std::size_t v) const { return nodes_[v]; }
+
+        private:
+            friend class reader;
+
+            struct open
+            {
+                node_type *n;
+                std::size_t first; // its first child in pending
+            };
+
+            std::vector<node_type> nodes_;
+            std::vector<node_type *> kids_;
+            std::vector<node_type *> pending_; // children whose ')' is still to come
+            std::vector<open> open_;
+        };
+
+        namespace details
+        {
+            using namespace layout::details;
+
+            // characters that end an unquoted label.
+            inline constexpr std::array<bool, 256> delimiter = []
+            {
+                std::array<bool, 256> d{};
+                for (unsigned char c : std::string_view("():,;[ \t\n\r"))
+                    d[c] = true;
+                return d;
+            }();
+
+            // white space and [comments].
+            inline void skip(const char *&p, const char *end)
+            {
+                while (p < end)
+                {
+                    char c = *p;
+                    if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+                        ++p;
+                    else if (c == '[')
+                    {
+                        auto *close = static_cast<const char *>(std::memchr(p, ']', std::size_t(end - p)));
+                        p = close ? close + 1 : end;
+                    }
+                    else
+                        break;
+                }
+            }
+
+            inline bool label(const char *&p, const char *end, std::string_view &out)
+            {
+                if (p < end && *p == '\'')
+                {
+                    const char *first = ++p;
+                    for (;;)
+                    {
+                        auto *q = static_cast<const char *>(std::memchr(p, '\'', std::size_t(end - p)));
+                        if (!q)
+                            return false;
+                        p = q + 1;
+                        if (p < end && *p == '\'') // '' is a quote inside the label
+                        {
+                            ++p;
+                            continue;
+                        }
+                        out = {first, std::size_t(q - first)};
+                        return true;
+                    }
+                }
+                const char *first = p;
+                while (p < end && !delimiter[static_cast<unsigned char>(*p)])
+                    ++p;
+                out = {first, std::size_t(p - first)};
+                return true;
+            }
+
+            // an upper bound on the nodes of a tree whose text is
+            // [p, end): one per ',' and '(' plus the root. quoted or
+            // commented ones only make it larger. eight bytes at a time.
+            inline std::size_t bound(const char *p, const char *end)
+            {
+                constexpr std::uint64_t ones = 0x0101010101010101ull, low = 0x7f7f7f7f7f7f7f7full;
+                // high bit set in every zero byte of x, exactly.
+                auto zeros = [](std::uint64_t x)
+                { return ~(((x & low) + low) | x | low); };
+                std::size_t n = 1;
+                while (end - p >= 8)
+                {
+                    // a 1 per match in each byte lane; flushed before a
+                    // lane can overflow.
+                    std::uint64_t lanes = 0;
+                    for (int k = 0; k < 255 && end - p >= 8; ++k, p += 8)
+                    {
+                        std::uint64_t w;
+                        std::memcpy(&w, p, 8);
+                        lanes += (zeros(w ^ ('(' * ones)) | zeros(w ^ (',' * ones))) >> 7;
+                    }
+                    for (int b = 0; b < 64; b += 8)
+                        n += std::size_t((lanes >> b) & 0xff);
+                }
+                for (; p < end; ++p)
+                    n += (*p == '(') | (*p == ',');
+                return n;
+            }
+
+            // label, branch length and size of n, read after its '(...)' or
+            // where it starts if it is a leaf.
+            template <typename T, typename Size>
+            bool finish(const char *&p, const char *end, node<T> *n, std::size_t v, const Size &size)
+            {
+                skip(p, end);
+                if (!label(p, end, n->label))
+                    return false;
+                skip(p, end);
+                if (p < end && *p == ':')
+                {
+                    skip(++p, end);
+                    if (!read_number(p, end, n->length))
+                        return false;
+                }
+                node_size s = size(n->label, v);
+                n->w = T(s.w);
+                n->h = T(s.h);
+                return true;
+            }
+
+            enum class outcome
+            {
+                ok,
+                bad,
+                full, // more nodes than bound() allowed for
+            };
+        } // namespace details
+
+        // —————————————————————————————————————————————————————
+        // reads the trees of a text one after the other.
+        class reader
+        {
+        public:
+            explicit reader(std::string_view text) : p_(text.data()), begin_(text.data()), end_(text.data() + text.size()) {}
+
+            /// parse the next tree into t. false at the end of the text or
+            /// on a syntax error (see failed()).
+            template <typename T, typename Size = label_size>
+                requires SizeSource<Size>
+            bool next(tree<T> &t, const Size &size = {})
+            {
+                details::skip(p_, end_);
+                t.nodes_.clear();
+                if (failed_ || p_ == end_)
+                    return false;
+
+                // a ';' inside a quoted label or a comment ends the first
+                // guess too early; then the node array fills up, and the
+                // count is redone up to the next ';'.
+                const char *semi = p_;
+                for (;;)
+                {
+                    auto *s = static_cast<const char *>(std::memchr(semi, ';', std::size_t(end_ - semi)));
+                    semi = s ? s + 1 : end_;
+                    std::size_t room = details::bound(p_, semi);
+                    t.nodes_.clear();
+                    t.nodes_.reserve(room);
+                    t.kids_.clear();
+                    t.kids_.reserve(room);
+                    t.pending_.clear();
+                    t.open_.clear();
+                    const char *p = p_;
+                    details::outcome r = parse(p, room, t, size);
+                    if (r == details::outcome::full && semi < end_)
+                        continue;
+                    if (r != details::outcome::ok)
+                    {
+                        failed_ = true;
+                        p_ = p;
+                        t.nodes_.clear();
+                        return false;
+                    }
+                    p_ = p;
+                    return true;
+                }
+            }
+
+            /// true once next() has met text that is not Newick.
+            bool failed() const { return failed_; }
+
+            /// bytes read so far; where the error is after a failure.
+            std::size_t offset() const { return std::size_t(p_ - begin_); }
+
+        private:
+            template <typename T, typename Size>
+            details::outcome parse(const char *&p, std::size_t room, tree<T> &t, const Size &size)
+            {
+                using details::outcome;
+                auto &nodes = t.nodes_;
+                auto &stack = t.open_;
+                auto &pending = t.pending_;
+                for (;;)
+                {
+                    // a node starts here.
+                    details::skip(p, end_);
+                    if (nodes.size() == room)
+                        return outcome::full;
+                    node<T> *n = &nodes.emplace_back();
+                    if (!stack.empty())
+                    {
+                        n->parent = stack.back().n;
+                        pending.push_back(n);
+                    }
+                    if (p < end_ && *p == '(')
+                    {
+                        ++p;
+                        stack.push_back({n, pending.size()});
+                        continue;
+                    }
+                    if (!details::finish(p, end_, n, nodes.size() - 1, size))
+                        return outcome::bad;
+
+                    // after a node: close groups until a ',' or the end.
+                    for (;;)
+                    {
+                        details::skip(p, end_);
+                        if (p == end_)
+                            return stack.empty() ? outcome::ok : outcome::bad; // ';' missing at the very end
+                        char c = *p++;
+                        if (c == ';')
+                            return stack.empty() ? outcome::ok : outcome::bad;
+                        if (c == ',' && !stack.empty())
+                            break;
+                        if (c != ')' || stack.empty())
+                            return outcome::bad;
+
+                        auto o = stack.back();
+                        stack.pop_back();
+                        std::size_t at = t.kids_.size();
+                        t.kids_.insert(t.kids_.end(), pending.begin() + std::ptrdiff_t(o.first), pending.end());
+                        pending.resize(o.first);
+                        o.n->children = {t.kids_.data() + at, t.kids_.size() - at};
+                        if (!details::finish(p, end_, o.n, std::size_t(o.n - nodes.data()), size))
+                            return outcome::bad;
+                    }
+                }
+            }
+
+            const char *p_, *begin_, *end_;
+            bool failed_ = false;
+        };
+
+        /// parse the first tree of text into t. false if there is none or
+        /// it is not valid Newick.
+        template <typename T, typename Size = label_size>
+            requires SizeSource<Size>
+        bool parse(std::string_view text, tree<T> &t, const Size &size = {})
+        {
+            reader r(text);
+            return r.next(t, size);
+        }
+
+        /// lay out every tree of text and hand it to use(tree<T> &), in
+        /// order. the next tree is parsed on a second thread while the
+        /// current one is laid out and used. false if the text is not
+        /// valid Newick; the trees before the error are still delivered.
+        template <typename T = double, typename F, typename Size = label_size>
+            requires SizeSource<Size>
+        bool pipeline(std::string_view text, const options &opt, F &&use, const Size &size = {})
+        {
+            tree<T> slots[2];
+            std::mutex m;
+            std::condition_variable cv;
+            std::size_t parsed = 0, used = 0;
+            bool finished = false, ok = true;
+
+            auto parse_all = [&]
+            {
+                reader r(text);
+                for (std::size_t k = 0;; ++k)
+                {
+                    {
+                        // slot k % 2 is free once tree k - 2 has been used.
+                        std::unique_lock lock(m);
+                        cv.wait(lock, [&] { return parsed - used < 2; });
+                    }
+                    bool got = r.next(slots[k % 2], size);
+                    {
+                        std::lock_guard lock(m);
+                        if (got)
+                            ++parsed;
+                        else
+                        {
+                            finished = true;
+                            ok = !r.failed();
+                        }
+                    }
+                    cv.notify_all();
+                    if (!got)
+                        return;
+                }
+            };
+            std::thread parser(parse_all);
+
+            for (std::size_t k = 0;; ++k)
+            {
+                {
+                    std::unique_lock lock(m);
+                    cv.wait(lock, [&] { return parsed > k || finished; });
+                    if (parsed == k)
+                        break;
+                }
+                tree<T> &t = slots[k % 2];
+                layout::layout(t.root(), opt);
+                use(t);
+                {
+                    std::lock_guard lock(m);
+                    ++used;
+                }
+                cv.notify_all();
+            }
+            parser.join();
+            return ok;
+        }
+
+    } // namespace newick
+} // namespace layout
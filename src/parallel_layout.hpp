@@ -0,0 +1,464 @@
+/**
+ *
+ * parallel first walk for nodes with a huge number of children.
+ *
+ * the children of a wide node are split into contiguous blocks, and the
+ * subtrees of each block are walked in parallel. merging is where the
+ * modes differ:
+ *
+ * integral (fixed-point) coordinates: each block is also merged on its own,
+ * as if its first child were the leftmost one, and the blocks are then
+ * joined in order:
+ *
+ *   - a block whose outline does not touch the ones before it is already
+ *     in its final place.
+ *   - a block that is pushed only through its first child, and whose other
+ *     children were each pushed against their left neighbour at the root
+ *     level, moves as a whole. the sequential merge would have pushed every
+ *     child by exactly that much more, with the same intermediate spreading.
+ *   - anything else is put back as it was before merging and merged child
+ *     by child, like firstwalk does.
+ *
+ * floating point coordinates: the blocks are merged child by child, left to
+ * right, on the calling thread. joining a block would add the pushes in
+ * another order, which changes the last bits, so only the walks of the
+ * subtrees run in parallel and the merge of a wide node stays serial.
+ * merge::reordered opts in to joining floating point blocks as well, with
+ * the same fallback: the merge runs in parallel too, and positions may
+ * differ from the sequential ones by a few ulps of the pushes summed.
+ *
+ * wide nodes inside a block are walked the same way, with their own
+ * threads, so nested fan-outs are parallel too.
+ *
+ * determinism: with merge::exact (the default) the result is bit for bit
+ * the one layout::layout() gives, for any number of threads and any
+ * scheduling. every value is computed by
+ * the same operations in the same order as in the sequential walk, except
+ * the sums reordered by joining a block, which is only done where addition
+ * is exact. block boundaries depend on the tree alone. verify() checks this
+ * on a given tree.
+ *
+ * only the first walk is parallel. layered and two_sided layouts, and
+ * custom separation policies, use the sequential layout.
+ *
+ */
+
+#pragma once
+#include "layout.hpp"
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <type_traits>
+
+namespace layout
+{
+    namespace parallel
+    {
+        // a node's children are merged in parallel blocks from this many on.
+        inline constexpr std::size_t wide = 4096;
+
+        /// how the blocks of a wide node are merged.
+        enum class merge
+        {
+            exact,     ///< bit for bit layout::layout(); floating point blocks merge serially
+            reordered, ///< floating point blocks are joined as well; equal up to rounding
+        };
+
+        namespace details
+        {
+            using namespace layout::details;
+
+            template <typename Node>
+            using sum_t = std::remove_cvref_t<decltype(std::declval<Node &>().msel)>;
+
+            // a child's root and extreme nodes as its own first walk left
+            // them; merging only ever writes these.
+            template <TreeNode Node>
+            struct saved_child
+            {
+                Node *el, *er;
+                field_t<Node> mod, shift, change;
+                sum_t<Node> msel, mser;
+                Node *el_tl, *el_tr, *er_tl, *er_tr;
+                field_t<Node> el_mod, el_prelim, er_mod, er_prelim;
+            };
+
+            template <TreeNode Node>
+            struct block
+            {
+                int first, last;
+                std::vector<saved_child<Node>> saved;
+                std::vector<coord_t<Node>> low; // IYL lowY of each child
+                // every child after the first met its left neighbour at the
+                // root level, so a push of the first one carries through.
+                bool tight = true;
+            };
+
+            template <TreeNode Node>
+            void save(Node *c, saved_child<Node> &s)
+            {
+                s = {c->el, c->er, c->mod, c->shift, c->change, c->msel, c->mser,
+                     c->el->tl, c->el->tr, c->er->tl, c->er->tr,
+                     c->el->mod, c->el->prelim, c->er->mod, c->er->prelim};
+            }
+
+            template <TreeNode Node>
+            void restore(Node *t, block<Node> &b)
+            {
+                for (int i = b.first; i < b.last; ++i)
+                {
+                    Node *c = t->children[i];
+                    const saved_child<Node> &s = b.saved[i - b.first];
+                    c->el = s.el;
+                    c->er = s.er;
+                    c->mod = s.mod;
+                    c->shift = s.shift;
+                    c->change = s.change;
+                    c->msel = s.msel;
+                    c->mser = s.mser;
+                }
+                // el and er may be the same node; put back er first so the
+                // values el saved win, they are the same anyway.
+                for (const saved_child<Node> &s : b.saved)
+                {
+                    s.er->tl = s.er_tl;
+                    s.er->tr = s.er_tr;
+                    s.er->mod = s.er_mod;
+                    s.er->prelim = s.er_prelim;
+                    s.el->tl = s.el_tl;
+                    s.el->tr = s.el_tr;
+                    s.el->mod = s.el_mod;
+                    s.el->prelim = s.el_prelim;
+                }
+            }
+
+            template <orientation O, TreeNode Node>
+            void walk(Node *t, unsigned threads, merge m);
+
+            template <orientation O, TreeNode Node>
+            // first walk of the children of a block. they do not depend on
+            // each other or on anything outside. a wide node among them gets
+            // its own blocks and threads.
+            void walk_block(Node *t, block<Node> &b, bool keep, unsigned threads, merge m)
+            {
+                if (keep)
+                    b.saved.resize(std::size_t(b.last - b.first));
+                for (int i = b.first; i < b.last; ++i)
+                {
+                    Node *c = t->children[i];
+                    walk<O>(c, threads, m);
+                    if (keep)
+                        save(c, b.saved[i - b.first]);
+                    b.low.push_back(bottom<O>(iyl_extreme(c, i == 0)));
+                }
+            }
+
+            template <orientation O, TreeNode Node>
+            // walk the children of a block and merge them among themselves.
+            void speculate(Node *t, block<Node> &b, unsigned threads, merge m)
+            {
+                using C = coord_t<Node>;
+                walk_block<O>(t, b, true, threads, m);
+
+                std::vector<IYL<C>> ih;
+                updateIYL(b.low[0], b.first, ih);
+                for (int i = b.first + 1; i < b.last; ++i)
+                {
+                    Node *l = t->children[i - 1], *c = t->children[i];
+                    C root = (C(l->mod) + l->prelim + breadth<O>(l) + spacing<Node>(H_SPACING)) - (C(c->mod) + c->prelim);
+                    if (root < 0)
+                        b.tight = false;
+                    separate<O>(t, i, ih, b.first);
+                    updateIYL(b.low[i - b.first], i, ih);
+                }
+            }
+
+            template <orientation O, TreeNode Node>
+            // join block b to the children before it as one piece. the walk is
+            // separate's, without writing anything until it is known that
+            // only the block's first child gets pushed. false if the block
+            // has to be merged child by child instead.
+            bool join(Node *t, block<Node> &b, const std::vector<IYL<coord_t<Node>>> &ih)
+            {
+                using C = coord_t<Node>;
+                struct push
+                {
+                    C dist;
+                    int si;
+                };
+                std::vector<push> pushes;
+
+                int i = b.first;
+                Node *own_el = b.saved[0].el;
+                bool own = true; // cl still on the first child's own contour
+                Node *sr = t->children[i - 1];
+                C mssr = sr->mod;
+                Node *cl = t->children[i];
+                C mscl = cl->mod;
+                std::size_t cursor = ih.size();
+
+                while (sr && cl)
+                {
+                    while (cursor && bottom<O>(sr) > ih[cursor - 1].lowY)
+                        --cursor;
+
+                    C dist = (mssr + sr->prelim + breadth<O>(sr) + spacing<Node>(H_SPACING)) - (mscl + cl->prelim);
+                    if (dist > 0)
+                    {
+                        if (!own || !b.tight)
+                            return false;
+                        mscl += dist;
+                        pushes.push_back({dist, cursor ? ih[cursor - 1].index : (i - 1)});
+                    }
+
+                    C sy = bottom<O>(sr), cy = bottom<O>(cl);
+                    if (sy <= cy)
+                    {
+                        sr = next_right_contour(sr);
+                        if (sr)
+                            mssr += sr->mod;
+                    }
+                    if (sy >= cy)
+                    {
+                        if (cl == own_el)
+                            own = false;
+                        cl = next_left_contour(cl);
+                        if (cl)
+                            mscl += cl->mod;
+                    }
+                }
+
+                C d = 0;
+                for (const push &p : pushes)
+                {
+                    move_subtree(t, i, p.si, p.dist);
+                    d += p.dist;
+                }
+                if (d != 0)
+                {
+                    for (int j = i + 1; j < b.last; ++j)
+                    {
+                        Node *c = t->children[j];
+                        c->mod += d;
+                        c->msel += d;
+                        c->mser += d;
+                    }
+                    // a thread into a child root of t skips the mod that
+                    // just moved it: the thread's own mod moves the other
+                    // way, so the contour sums stay right.
+                    auto unshift = [&](Node *n)
+                    {
+                        n->mod -= d;
+                        n->prelim += d;
+                    };
+                    for (const saved_child<Node> &s : b.saved)
+                    {
+                        bool left = s.el->tl && s.el->tl->parent == t;
+                        if (left)
+                            unshift(s.el);
+                        if (s.er->tr && s.er->tr->parent == t && !(left && s.er == s.el))
+                            unshift(s.er);
+                    }
+                }
+
+                if (sr == nullptr && cl != nullptr)
+                    set_left_thread(t, i, cl, mscl);
+                else if (sr != nullptr && cl == nullptr)
+                {
+                    // set_right_thread, with the block's right extreme kept
+                    // on its last child.
+                    Node *last = t->children[b.last - 1];
+                    Node *ri = last->er;
+                    ri->tr = sr;
+                    C diff = (mssr - sr->mod) - last->mser;
+                    ri->mod += diff;
+                    ri->prelim -= diff;
+                    last->er = t->children[i - 1]->er;
+                    last->mser = t->children[i - 1]->mser;
+                }
+                return true;
+            }
+
+            template <orientation O, TreeNode Node>
+            void walk_wide(Node *t, unsigned threads, merge m)
+            {
+                using C = coord_t<Node>;
+                // moving a merged block as a whole adds up the same pushes
+                // in another order, which only integers forgive, unless the
+                // caller asked for it.
+                const bool reorder = std::is_integral_v<C> || m == merge::reordered;
+
+                // block boundaries depend on the tree only, not on threads.
+                std::size_t n = t->children.size();
+                std::size_t size = n / 256;
+                if (size < 256)
+                    size = 256;
+
+                std::vector<block<Node>> blocks;
+                for (std::size_t f = 0; f < n; f += size)
+                    blocks.push_back({int(f), int(f + size < n ? f + size : n), {}, {}, true});
+
+                std::atomic<std::size_t> next{0};
+                auto work = [&]
+                {
+                    for (std::size_t k; (k = next++) < blocks.size();)
+                        if (reorder)
+                            speculate<O>(t, blocks[k], threads, m);
+                        else
+                            walk_block<O>(t, blocks[k], false, threads, m);
+                };
+                std::vector<std::thread> pool;
+                for (unsigned k = 1; k < threads && k < blocks.size(); ++k)
+                    pool.emplace_back(work);
+                work();
+                for (std::thread &th : pool)
+                    th.join();
+
+                // blocks are merged in child order; the first one was
+                // merged exactly as firstwalk would.
+                std::vector<IYL<C>> ih;
+                updateIYL(blocks[0].low[0], 0, ih);
+                for (std::size_t k = 0; k < blocks.size(); ++k)
+                {
+                    block<Node> &b = blocks[k];
+                    bool merged = reorder && (k == 0 || join<O>(t, b, ih));
+                    if (!merged)
+                    {
+                        if (reorder)
+                            restore(t, b);
+                        for (int i = std::max(b.first, 1); i < b.last; ++i)
+                        {
+                            separate<O>(t, i, ih);
+                            updateIYL(b.low[i - b.first], i, ih);
+                        }
+                        continue;
+                    }
+                    for (int i = std::max(b.first, 1); i < b.last; ++i)
+                        updateIYL(b.low[i - b.first], i, ih);
+                }
+            }
+
+            template <orientation O, TreeNode Node>
+            // firstwalk, handing wide nodes to walk_wide.
+            void walk(Node *t, unsigned threads, merge m)
+            {
+                reset(t);
+                if (t->parent)
+                    depth_pos<O>(t) = depth_pos<O>(t->parent) + extent<O>(t->parent) + spacing<Node>(V_SPACING);
+                else
+                    depth_pos<O>(t) = 0;
+
+                if (t->children.empty())
+                {
+                    set_extremes(t);
+                    return;
+                }
+
+                if (t->children.size() >= wide && threads > 1)
+                    walk_wide<O>(t, threads, m);
+                else
+                {
+                    walk<O>(t->children[0], threads, m);
+                    std::vector<IYL<coord_t<Node>>> ih;
+                    updateIYL(bottom<O>(iyl_extreme(t->children[0], true)), 0, ih);
+                    for (int i = 1; i < (int)t->children.size(); ++i)
+                    {
+                        walk<O>(t->children[i], threads, m);
+                        coord_t<Node> minY = bottom<O>(iyl_extreme(t->children[i], false));
+                        separate<O>(t, i, ih);
+                        updateIYL(minY, i, ih);
+                    }
+                }
+
+                position_root<O>(t);
+                set_extremes(t);
+            }
+
+        } // namespace details
+
+        /// layout::layout() with the children of wide nodes walked on up to
+        /// `threads` threads (0: one per hardware thread). with merge::exact
+        /// bit for bit the same result as the sequential layout; with
+        /// merge::reordered floating point blocks are merged in parallel as
+        /// well, and positions are only equal up to rounding.
+        template <TreeNode Node>
+        void layout(Node *t, const options &opt, unsigned threads, merge m)
+        {
+            if (threads == 0)
+                threads = std::thread::hardware_concurrency();
+            if (opt.layered || (opt.two_sided && !opt.radial) || threads < 2)
+                return layout::layout(t, opt);
+
+            layout::details::with_orientation(opt.radial ? orientation::top_down : opt.orientation,
+                                              [&]<orientation O>()
+                                              {
+                                                  details::walk<O>(t, threads, m);
+                                                  layout::details::secondwalk_root<O>(t, opt);
+                                              });
+        }
+
+        /// as above, with merge::exact. a separation policy other than
+        /// constant_separation is passed on to the sequential layout.
+        template <TreeNode Node, typename Sep = constant_separation>
+        void layout(Node *t, const options &opt = {}, unsigned threads = 0, const Sep &sep = {})
+        {
+            if constexpr (!std::is_same_v<Sep, constant_separation>)
+                layout::layout(t, opt, sep);
+            else
+                parallel::layout(t, opt, threads, merge::exact);
+        }
+
+        // first node, in preorder, whose position differs between the
+        // sequential and the parallel layout.
+        template <TreeNode Node>
+        struct mismatch
+        {
+            Node *node = nullptr; // nullptr: the layouts are identical
+            std::size_t index = 0;
+            layout::details::field_t<Node> serial_x{}, serial_y{}, parallel_x{}, parallel_y{};
+        };
+
+        /// lay t out sequentially and in parallel and compare the positions
+        /// bit for bit. t is left with the parallel layout.
+        template <TreeNode Node>
+        mismatch<Node> verify(Node *t, const options &opt = {}, unsigned threads = 0)
+        {
+            using F = layout::details::field_t<Node>;
+            std::vector<Node *> order;
+            std::vector<Node *> stack{t};
+            while (!stack.empty())
+            {
+                Node *n = stack.back();
+                stack.pop_back();
+                order.push_back(n);
+                for (std::size_t k = n->children.size(); k-- > 0;)
+                    stack.push_back(n->children[k]);
+            }
+
+            layout::layout(t, opt);
+            std::vector<F> xy;
+            xy.reserve(2 * order.size());
+            for (Node *n : order)
+            {
+                xy.push_back(n->x);
+                xy.push_back(n->y);
+            }
+
+            layout(t, opt, threads);
+            auto same = [](const F &a, const F &b)
+            { return std::memcmp(&a, &b, sizeof(F)) == 0; };
+            for (std::size_t k = 0; k < order.size(); ++k)
+            {
+                Node *n = order[k];
+                F x = n->x, y = n->y;
+                if (!same(x, xy[2 * k]) || !same(y, xy[2 * k + 1]))
+                    return {n, k, xy[2 * k], xy[2 * k + 1], x, y};
+            }
+            return {};
+        }
+
+    } // namespace parallel
+} // namespace layout
@@ -0,0 +1,279 @@
+/**
+ *
+ * client side of the local layout service (server/layout_server.cpp).
+ *
+ * instead of embedding the layout, a process can send its trees to one
+ * shared server over a Unix domain socket and get the coordinates back.
+ *
+ * wire format, host byte order (both ends are on the same machine):
+ *
+ *   request : request_header, then `count` node_records in preorder. a
+ *             node's record gives its size and number of children, which
+ *             is enough to rebuild the tree.
+ *   response: response_header, then `count` positions in the same order
+ *             (none if status is not ok).
+ *
+ * requests with identical bytes get identical answers, which is what the
+ * server's cache relies on. trees deeper than max_depth are refused: the
+ * layout recurses once per level, on a worker thread's stack.
+ *
+ * POSIX only.
+ *
+ */
+
+#pragma once
+#include "layout.hpp"
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace layout
+{
+    namespace service
+    {
+        // —————————————————————————————————————————————————————
+        inline constexpr std::uint32_t request_magic = 0x51525454;  // "TTRQ"
+        inline constexpr std::uint32_t response_magic = 0x53525454; // "TTRS"
+        inline constexpr std::uint32_t version = 1;
+
+        // deepest tree decode() accepts, counting the root as depth 0.
+        inline constexpr std::uint32_t max_depth = 1u << 13;
+
+        struct request_header
+        {
+            std::uint32_t magic = request_magic, version = service::version;
+            std::uint32_t count = 0; // nodes
+            std::uint8_t orientation = 0, layered = 0, two_sided = 0, radial = 0;
+        };
+
+        struct node_record
+        {
+            double w, h;
+            std::uint32_t children, reserved = 0;
+        };
+
+        enum class status : std::uint32_t
+        {
+            ok = 0,
+            bad_request = 1,
+        };
+
+        struct response_header
+        {
+            std::uint32_t magic = response_magic;
+            status result = status::ok;
+            std::uint32_t count = 0, reserved = 0;
+        };
+
+        struct position
+        {
+            double x, y;
+        };
+
+        namespace details
+        {
+            using namespace layout::details;
+
+            inline bool send_all(int fd, const void *data, std::size_t size)
+            {
+                const char *p = static_cast<const char *>(data);
+                while (size > 0)
+                {
+                    ssize_t k = send(fd, p, size, MSG_NOSIGNAL);
+                    if (k < 0 && errno == EINTR)
+                        continue;
+                    if (k <= 0)
+                        return false;
+                    p += k;
+                    size -= std::size_t(k);
+                }
+                return true;
+            }
+
+            inline bool recv_all(int fd, void *data, std::size_t size)
+            {
+                char *p = static_cast<char *>(data);
+                while (size > 0)
+                {
+                    ssize_t k = recv(fd, p, size, 0);
+                    if (k < 0 && errno == EINTR)
+                        continue;
+                    if (k <= 0)
+                        return false;
+                    p += k;
+                    size -= std::size_t(k);
+                }
+                return true;
+            }
+
+            template <typename T>
+            void append(std::vector<char> &out, const T &v)
+            {
+                const char *p = reinterpret_cast<const char *>(&v);
+                out.insert(out.end(), p, p + sizeof(T));
+            }
+        } // namespace details
+
+        /// append the request for laying out the tree at t to out.
+        template <TreeNode Node>
+        void encode(Node *t, const options &opt, std::vector<char> &out)
+        {
+            std::size_t at = out.size();
+            request_header h;
+            h.orientation = std::uint8_t(opt.orientation);
+            h.layered = opt.layered;
+            h.two_sided = opt.two_sided;
+            h.radial = opt.radial;
+            details::append(out, h);
+
+            std::uint32_t n = 0;
+            std::vector<Node *> stack{t};
+            while (!stack.empty())
+            {
+                Node *c = stack.back();
+                stack.pop_back();
+                details::append(out, node_record{double(c->w), double(c->h), std::uint32_t(c->children.size())});
+                ++n;
+                stack.insert(stack.end(), c->children.rbegin(), c->children.rend());
+            }
+            std::memcpy(out.data() + at + offsetof(request_header, count), &n, sizeof n);
+        }
+
+        /// rebuild the tree of a request in nodes (reused between calls) and
+        /// return its root; nullptr if the records do not form one tree or
+        /// it is deeper than max_depth.
+        template <TreeNode Node>
+        Node *decode(const request_header &h, const node_record *records, std::vector<Node> &nodes, options &opt)
+        {
+            if (h.count == 0 || h.orientation > 3)
+                return nullptr;
+            opt = {};
+            opt.orientation = layout::orientation(h.orientation);
+            opt.layered = h.layered;
+            opt.two_sided = h.two_sided;
+            opt.radial = h.radial;
+
+            nodes.resize(h.count);
+            struct open
+            {
+                Node *n;
+                std::uint32_t left; // children still to come
+            };
+            std::vector<open> stack;
+            for (std::uint32_t i = 0; i < h.count; ++i)
+            {
+                Node &n = nodes[i];
+                n.children.clear();
+                n.w = records[i].w;
+                n.h = records[i].h;
+                n.parent = nullptr;
+                while (!stack.empty() && stack.back().left == 0)
+                    stack.pop_back();
+                if (i > 0)
+                {
+                    if (stack.empty())
+                        return nullptr; // a second root
+                    if (stack.size() > max_depth)
+                        return nullptr; // too deep to lay out
+                    n.parent = stack.back().n;
+                    n.parent->children.push_back(&n);
+                    --stack.back().left;
+                }
+                stack.push_back({&n, records[i].children});
+            }
+            for (const open &o : stack)
+                if (o.left != 0)
+                    return nullptr; // children promised but missing
+            return &nodes[0];
+        }
+
+        // —————————————————————————————————————————————————————
+        // a connection to the server, kept open between layouts.
+        class client
+        {
+        public:
+            explicit client(const char *path)
+            {
+                sockaddr_un addr{};
+                addr.sun_family = AF_UNIX;
+                if (std::strlen(path) >= sizeof addr.sun_path)
+                    return;
+                std::strcpy(addr.sun_path, path);
+                fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+                if (fd_ >= 0 && connect(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0)
+                {
+                    ::close(fd_);
+                    fd_ = -1;
+                }
+            }
+
+            client(const client &) = delete;
+            client &operator=(const client &) = delete;
+
+            ~client()
+            {
+                if (fd_ >= 0)
+                    ::close(fd_);
+            }
+
+            bool ok() const { return fd_ >= 0; }
+
+            /// lay out the tree at t on the server and store x,y in its
+            /// nodes. false if the server could not be reached or refused
+            /// the request; the connection is unusable afterwards.
+            template <TreeNode Node>
+            bool layout(Node *t, const options &opt = {})
+            {
+                if (fd_ < 0)
+                    return false;
+                buf_.clear();
+                encode(t, opt, buf_);
+                response_header r;
+                bool ok = details::send_all(fd_, buf_.data(), buf_.size()) &&
+                          details::recv_all(fd_, &r, sizeof r) &&
+                          r.magic == response_magic && r.result == status::ok;
+                std::uint32_t n = 0;
+                if (ok)
+                {
+                    std::memcpy(&n, buf_.data() + offsetof(request_header, count), sizeof n);
+                    ok = r.count == n;
+                }
+                if (ok)
+                {
+                    pos_.resize(n);
+                    ok = details::recv_all(fd_, pos_.data(), n * sizeof(position));
+                }
+                if (!ok)
+                {
+                    ::close(fd_);
+                    fd_ = -1;
+                    return false;
+                }
+
+                std::size_t k = 0;
+                std::vector<Node *> stack{t};
+                while (!stack.empty())
+                {
+                    Node *c = stack.back();
+                    stack.pop_back();
+                    c->x = decltype(c->x)(pos_[k].x);
+                    c->y = decltype(c->y)(pos_[k].y);
+                    ++k;
+                    stack.insert(stack.end(), c->children.rbegin(), c->children.rend());
+                }
+                return true;
+            }
+
+        private:
+            int fd_ = -1;
+            std::vector<char> buf_;
+            std::vector<position> pos_;
+        };
+
+    } // namespace service
+} // namespace layout
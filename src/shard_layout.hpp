@@ -0,0 +1,384 @@
+/**
+ *
+ * sharded layout: lay out the big subtrees of a tree in separate processes.
+ *
+ * the tree is cut into shards, subtrees of at most limits::max_nodes nodes
+ * each, found with one metrics pass (see metrics.hpp). shards are handed out
+ * in jobs of up to max_nodes nodes to forked worker processes. a worker lays
+ * out each of its shards as a tree of its own and sends back, over a pipe,
+ * the shard's contour envelope (see lod_layout.hpp) and the position of
+ * every node relative to the shard root. the parent then lays out the top
+ * of the tree with the envelopes standing in for the shards, which takes
+ * the same separate() steps as merging the real subtrees, and moves every
+ * shard node to its root's final position plus its relative one.
+ *
+ * a worker only writes the nodes of its own job, so the memory it adds on
+ * top of the parent's (shared copy-on-write after fork) is bounded by the
+ * job size. if a worker cannot be started or does not report back, its job
+ * is laid out in the parent instead.
+ *
+ * positions match layout::layout() exactly for integral (fixed-point)
+ * coordinates, and up to rounding for floating point ones. honours
+ * options::orientation; layered, two_sided and radial layouts, and custom
+ * separation policies, are done by layout::layout() in the calling process.
+ *
+ * POSIX only. fork() copies just the calling thread: call it when no other
+ * thread of the program may be holding a lock (e.g. inside malloc).
+ *
+ */
+
+#pragma once
+#include "layout.hpp"
+#include "lod_layout.hpp"
+#include "metrics.hpp"
+#include <vector>
+#include <deque>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+namespace layout
+{
+    namespace shard
+    {
+        // —————————————————————————————————————————————————————
+        struct limits
+        {
+            std::size_t max_nodes = std::size_t(1) << 20; // per shard and per worker
+            unsigned processes = 0;                       // workers at a time; 0: one per hardware thread
+        };
+
+        namespace details
+        {
+            using namespace layout::details;
+
+            // what a worker sends back, raw: the parent is the same program.
+            class writer
+            {
+            public:
+                template <typename T>
+                void put(const T &v)
+                {
+                    const char *p = reinterpret_cast<const char *>(&v);
+                    bytes.insert(bytes.end(), p, p + sizeof(T));
+                }
+
+                std::vector<char> bytes;
+            };
+
+            class reader
+            {
+            public:
+                explicit reader(const std::vector<char> &b) : p_(b.data()), end_(b.data() + b.size()) {}
+
+                // false once the message is cut short.
+                template <typename T>
+                bool get(T &v)
+                {
+                    if (std::size_t(end_ - p_) < sizeof(T))
+                        return false;
+                    std::memcpy(&v, p_, sizeof(T));
+                    p_ += sizeof(T);
+                    return true;
+                }
+
+            private:
+                const char *p_, *end_;
+            };
+
+            template <TreeNode Node>
+            void preorder(Node *t, std::vector<Node *> &out)
+            {
+                std::vector<Node *> stack{t};
+                while (!stack.empty())
+                {
+                    Node *n = stack.back();
+                    stack.pop_back();
+                    out.push_back(n);
+                    for (std::size_t k = n->children.size(); k-- > 0;)
+                        stack.push_back(n->children[k]);
+                }
+            }
+
+            template <orientation O, TreeNode Node>
+            // lay out each shard of a job as a tree of its own and describe
+            // the result: envelope, node count, relative x,y in preorder.
+            // offsets go out in coord_t, so float nodes are only rounded
+            // once, when the parent stores them.
+            void run_job(const std::vector<Node *> &job, const options &opt, writer &w)
+            {
+                using C = coord_t<Node>;
+                std::vector<Node *> nodes;
+                for (Node *s : job)
+                {
+                    Node *up = s->parent;
+                    s->parent = nullptr;
+                    firstwalk<O>(s);
+                    lod::envelope<Node> e;
+                    lod::details::record<O>(s, e);
+                    secondwalk_root<O>(s, opt);
+                    s->parent = up;
+
+                    w.put(e.prelim);
+                    w.put(e.msel);
+                    w.put(e.mser);
+                    w.put(std::uint64_t(e.left.size()));
+                    w.put(std::uint64_t(e.right.size()));
+                    for (const auto &st : e.left)
+                        w.put(st);
+                    for (const auto &st : e.right)
+                        w.put(st);
+
+                    nodes.clear();
+                    preorder(s, nodes);
+                    w.put(std::uint64_t(nodes.size()));
+                    for (Node *n : nodes)
+                    {
+                        w.put(C(n->x) - C(s->x));
+                        w.put(C(n->y) - C(s->y));
+                    }
+                }
+            }
+
+            // relative positions of one shard's nodes, in preorder.
+            template <TreeNode Node>
+            struct placed
+            {
+                Node *root;
+                std::vector<coord_t<Node>> xy;
+            };
+
+            template <TreeNode Node>
+            // read a job's results into the cache and out. false if the
+            // message does not describe the job.
+            bool read_job(const std::vector<Node *> &job, const std::vector<char> &bytes, lod::cache<Node> &ch, std::vector<placed<Node>> &out)
+            {
+                reader r(bytes);
+                std::size_t done = out.size();
+                for (Node *s : job)
+                {
+                    lod::envelope<Node> e;
+                    std::uint64_t nl, nr, n;
+                    if (!r.get(e.prelim) || !r.get(e.msel) || !r.get(e.mser) || !r.get(nl) || !r.get(nr))
+                        break;
+                    e.left.resize(nl);
+                    e.right.resize(nr);
+                    bool ok = true;
+                    for (auto &st : e.left)
+                        ok = ok && r.get(st);
+                    for (auto &st : e.right)
+                        ok = ok && r.get(st);
+                    if (!ok || !r.get(n))
+                        break;
+                    placed<Node> p{s, std::vector<coord_t<Node>>(2 * n)};
+                    for (auto &v : p.xy)
+                        ok = ok && r.get(v);
+                    if (!ok)
+                        break;
+                    ch.insert(s) = std::move(e);
+                    out.push_back(std::move(p));
+                }
+                if (out.size() - done == job.size())
+                    return true;
+                for (std::size_t k = done; k < out.size(); ++k)
+                    ch.invalidate(out[k].root);
+                out.resize(done);
+                return false;
+            }
+
+            struct worker
+            {
+                pid_t pid = -1;
+                int fd = -1;
+            };
+
+            template <orientation O, TreeNode Node>
+            // fork a process that runs the job and writes its results to a
+            // pipe. false if that is not possible.
+            bool spawn(const std::vector<Node *> &job, const options &opt, worker &wk)
+            {
+                int fds[2];
+                if (pipe(fds) != 0)
+                    return false;
+                pid_t pid = fork();
+                if (pid < 0)
+                {
+                    close(fds[0]);
+                    close(fds[1]);
+                    return false;
+                }
+                if (pid == 0)
+                {
+                    close(fds[0]);
+                    writer w;
+                    run_job<O>(job, opt, w);
+                    const char *p = w.bytes.data();
+                    std::size_t left = w.bytes.size();
+                    while (left > 0)
+                    {
+                        ssize_t k = write(fds[1], p, left);
+                        if (k < 0 && errno == EINTR)
+                            continue;
+                        if (k <= 0)
+                            _exit(1);
+                        p += k;
+                        left -= std::size_t(k);
+                    }
+                    _exit(0);
+                }
+                close(fds[1]);
+                wk = {pid, fds[0]};
+                return true;
+            }
+
+            // read everything the worker wrote and reap it. false if it
+            // failed.
+            inline bool finish(worker &wk, std::vector<char> &bytes)
+            {
+                bytes.clear();
+                char buf[1 << 16];
+                bool ok = true;
+                for (;;)
+                {
+                    ssize_t k = read(wk.fd, buf, sizeof buf);
+                    if (k < 0 && errno == EINTR)
+                        continue;
+                    if (k < 0)
+                        ok = false;
+                    if (k <= 0)
+                        break;
+                    bytes.insert(bytes.end(), buf, buf + k);
+                }
+                close(wk.fd);
+                int status = 0;
+                while (waitpid(wk.pid, &status, 0) < 0 && errno == EINTR)
+                    ;
+                return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+            }
+
+            template <TreeNode Node>
+            // the largest subtrees below the root that fit in one shard,
+            // in preorder, grouped into jobs of at most max_nodes nodes.
+            // leaves are left to the top layout.
+            std::vector<std::vector<Node *>> plan(Node *t, std::size_t max_nodes)
+            {
+                metrics::table<Node> m;
+                metrics::compute(t, m);
+                std::vector<std::vector<Node *>> jobs;
+                std::size_t load = 0;
+                std::vector<std::size_t> stack{0}, kids;
+                while (!stack.empty())
+                {
+                    std::size_t v = stack.back();
+                    stack.pop_back();
+                    if (v != 0 && m[v].size <= max_nodes)
+                    {
+                        if (m[v].size == 1)
+                            continue;
+                        if (jobs.empty() || load + m[v].size > max_nodes)
+                        {
+                            jobs.emplace_back();
+                            load = 0;
+                        }
+                        jobs.back().push_back(m.node(v));
+                        load += m[v].size;
+                        continue;
+                    }
+                    kids.clear();
+                    for (std::size_t c = v + 1, i = 0; i < m.node(v)->children.size(); ++i, c = m.next_sibling(c))
+                        kids.push_back(c);
+                    stack.insert(stack.end(), kids.rbegin(), kids.rend());
+                }
+                return jobs;
+            }
+
+            template <orientation O, TreeNode Node>
+            void run(Node *t, const limits &lim, const options &opt)
+            {
+                std::vector<std::vector<Node *>> jobs = plan(t, lim.max_nodes);
+                if (jobs.empty())
+                    return layout::layout(t, opt);
+                unsigned processes = lim.processes ? lim.processes : std::thread::hardware_concurrency();
+                if (processes == 0)
+                    processes = 1;
+
+                // results are read in job order; up to `processes` workers
+                // run ahead of the one being read.
+                lod::cache<Node> ch;
+                std::vector<placed<Node>> shards;
+                std::deque<std::pair<std::size_t, worker>> running;
+                std::vector<char> bytes;
+                std::size_t next = 0;
+                auto in_process = [&](std::size_t k)
+                {
+                    writer w;
+                    run_job<O>(jobs[k], opt, w);
+                    read_job(jobs[k], w.bytes, ch, shards);
+                };
+                while (next < jobs.size() || !running.empty())
+                {
+                    while (next < jobs.size() && running.size() < processes)
+                    {
+                        worker wk;
+                        if (!spawn<O>(jobs[next], opt, wk))
+                            break;
+                        running.push_back({next++, wk});
+                    }
+                    if (running.empty())
+                    {
+                        in_process(next++);
+                        continue;
+                    }
+                    auto [k, wk] = running.front();
+                    running.pop_front();
+                    if (!finish(wk, bytes) || !read_job(jobs[k], bytes, ch, shards))
+                        in_process(k);
+                }
+
+                auto cut = [&](Node *n, std::size_t)
+                { return ch.find(n) != nullptr; };
+                lod::details::run<O>(t, cut, ch);
+
+                using C = coord_t<Node>;
+                using F = field_t<Node>;
+                std::vector<Node *> nodes;
+                for (const placed<Node> &p : shards)
+                {
+                    nodes.clear();
+                    preorder(p.root, nodes);
+                    C x = p.root->x, y = p.root->y;
+                    for (std::size_t k = 0; k < nodes.size(); ++k)
+                    {
+                        nodes[k]->x = F(x + p.xy[2 * k]);
+                        nodes[k]->y = F(y + p.xy[2 * k + 1]);
+                    }
+                }
+            }
+
+        } // namespace details
+
+        /// layout::layout(t, opt), with every subtree of up to
+        /// lim.max_nodes nodes laid out in a worker process. Node must be
+        /// default constructible and its children must support push_back,
+        /// as for lod::layout. a separation policy other than
+        /// constant_separation is passed on to layout::layout in the
+        /// calling process, since the envelopes are merged through proxies.
+        template <TreeNode Node, typename Sep = constant_separation>
+            requires std::default_initializable<Node> && requires(Node n, Node *c) { n.children.push_back(c); }
+        void layout(Node *t, const limits &lim = {}, const options &opt = {}, const Sep &sep = {})
+        {
+            if (opt.layered || opt.two_sided || opt.radial || !std::is_same_v<Sep, constant_separation>)
+                return layout::layout(t, opt, sep);
+            layout::details::with_orientation(opt.orientation,
+                                              [&]<orientation O>()
+                                              { details::run<O>(t, lim, opt); });
+        }
+
+    } // namespace shard
+} // namespace layout
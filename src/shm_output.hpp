@@ -0,0 +1,326 @@
+/**
+ *
+ * publish layout results to other processes through POSIX shared memory.
+ *
+ * a publisher owns a named segment: a small header, then x and y of up to
+ * `capacity` nodes as doubles, then an optional fixed-size record per node
+ * (colour, id, whatever the renderer wants next to the position). nodes are
+ * stored in preorder. publish() writes straight from the tree into the
+ * segment, so a relayout costs no serialization and no copy on either side.
+ *
+ * the header holds a sequence lock. the counter is odd while a publish is
+ * in progress and even otherwise; a reader takes a snapshot by reading the
+ * counter, the data, then the counter again, and retries if it changed.
+ * readers never block the publisher, and give up after a timeout if the
+ * counter stays odd (a publisher that died mid-publish).
+ *
+ * a publisher only creates a new segment: if the name is taken, e.g. by a
+ * publisher that crashed before removing it, it fails rather than take
+ * over a segment others may be writing. shm_unlink the name first when
+ * that is what you want.
+ *
+ *   segment: header (64 bytes) | x[capacity] | y[capacity] | pad | records
+ *
+ * records start on a 64-byte boundary, so frame::record<>() reads them in
+ * place for any Record aligned to at most 64. a capacity and record size
+ * whose segment would not fit in the address space (or an off_t) are
+ * refused.
+ *
+ * POSIX only (shm_open/mmap; glibc before 2.34 needs -lrt).
+ *
+ */
+
+#pragma once
+#include "layout.hpp"
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace layout
+{
+    namespace shm
+    {
+        namespace details
+        {
+            inline constexpr std::uint32_t magic = 0x4d535454; // "TTSM"
+            inline constexpr std::uint32_t version = 2;
+            inline constexpr std::size_t record_align = 64;
+
+            static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+                          "the sequence lock must work across processes");
+
+            struct alignas(64) header
+            {
+                std::uint32_t magic, version;
+                std::uint64_t capacity;    // nodes
+                std::uint64_t record_size; // bytes per node, 0 for none
+                std::atomic<std::uint64_t> seq;
+                std::uint64_t count; // nodes in the last publish
+            };
+
+            // offset of the first record: after x and y, rounded up to
+            // record_align. only for capacities segment_size() accepts.
+            inline std::size_t records_offset(std::size_t capacity)
+            {
+                std::size_t end = sizeof(header) + 2 * sizeof(double) * capacity;
+                return (end + record_align - 1) / record_align * record_align;
+            }
+
+            // bytes of a segment for capacity nodes with records of
+            // record_size bytes, in size. false if that overflows.
+            inline bool segment_size(std::size_t capacity, std::size_t record_size, std::size_t &size)
+            {
+                constexpr std::size_t max = std::min(std::size_t(PTRDIFF_MAX), std::size_t(std::numeric_limits<off_t>::max()));
+                constexpr std::size_t room = max - sizeof(header) - record_align;
+                if (record_size > room - 2 * sizeof(double))
+                    return false;
+                std::size_t per_node = 2 * sizeof(double) + record_size;
+                if (capacity > room / per_node)
+                    return false;
+                size = records_offset(capacity) + capacity * record_size;
+                return true;
+            }
+        } // namespace details
+
+        // —————————————————————————————————————————————————————
+        // the writing side. creates the segment, failing if the name is
+        // already taken, and removes the name when destroyed; readers that
+        // have it mapped keep their mapping.
+        class publisher
+        {
+        public:
+            publisher(const char *name, std::size_t capacity, std::size_t record_size = 0)
+                : name_(name)
+            {
+                if (!details::segment_size(capacity, record_size, size_))
+                    return;
+                int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+                if (fd < 0)
+                    return;
+                void *p = MAP_FAILED;
+                if (ftruncate(fd, off_t(size_)) == 0)
+                    p = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                close(fd);
+                if (p == MAP_FAILED)
+                {
+                    shm_unlink(name);
+                    return;
+                }
+                h_ = new (p) details::header{details::magic, details::version, capacity, record_size, {0}, 0};
+            }
+
+            publisher(const publisher &) = delete;
+            publisher &operator=(const publisher &) = delete;
+
+            ~publisher()
+            {
+                if (!h_)
+                    return;
+                munmap(h_, size_);
+                shm_unlink(name_.c_str());
+            }
+
+            // false if the segment could not be created, or the name exists.
+            bool ok() const { return h_ != nullptr; }
+
+            std::size_t capacity() const { return h_ ? std::size_t(h_->capacity) : 0; }
+
+            // write the positions of the tree at t. false (and nothing
+            // published) if the tree has more than capacity() nodes.
+            template <TreeNode Node>
+            bool publish(Node *t)
+            {
+                return write(t, [](Node *, std::byte *) {});
+            }
+
+            // same, with fill(node) giving each node's record. Record must
+            // be trivially copyable and match the segment's record size.
+            template <typename Fill, TreeNode Node>
+            bool publish(Node *t, const Fill &fill)
+            {
+                using Record = std::invoke_result_t<const Fill &, const Node *>;
+                static_assert(std::is_trivially_copyable_v<Record>);
+                static_assert(alignof(Record) <= details::record_align, "records are only 64-byte aligned");
+                if (!h_ || h_->record_size != sizeof(Record))
+                    return false;
+                return write(t, [&](Node *n, std::byte *out)
+                             {
+                                 Record r = fill(static_cast<const Node *>(n));
+                                 std::memcpy(out, &r, sizeof(Record));
+                             });
+            }
+
+        private:
+            template <TreeNode Node, typename Rec>
+            bool write(Node *t, const Rec &rec)
+            {
+                if (!h_)
+                    return false;
+                std::size_t cap = std::size_t(h_->capacity), rs = std::size_t(h_->record_size);
+                double *x = reinterpret_cast<double *>(h_ + 1);
+                double *y = x + cap;
+                std::byte *records = reinterpret_cast<std::byte *>(h_) + details::records_offset(cap);
+
+                // count first: a publish that does not fit must not
+                // start, or readers would lose the previous results.
+                std::vector<Node *> stack{t};
+                std::size_t n = 0;
+                while (!stack.empty() && n <= cap)
+                {
+                    Node *c = stack.back();
+                    stack.pop_back();
+                    ++n;
+                    stack.insert(stack.end(), c->children.rbegin(), c->children.rend());
+                }
+                if (n > cap)
+                    return false;
+
+                std::uint64_t s = h_->seq.load(std::memory_order_relaxed);
+                h_->seq.store(s + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+
+                stack.assign(1, t);
+                std::size_t k = 0;
+                while (!stack.empty())
+                {
+                    Node *c = stack.back();
+                    stack.pop_back();
+                    x[k] = double(c->x);
+                    y[k] = double(c->y);
+                    if (rs)
+                        rec(c, records + k * rs);
+                    ++k;
+                    stack.insert(stack.end(), c->children.rbegin(), c->children.rend());
+                }
+                h_->count = k;
+
+                h_->seq.store(s + 2, std::memory_order_release);
+                return true;
+            }
+
+            std::string name_;
+            std::size_t size_ = 0;
+            details::header *h_ = nullptr;
+        };
+
+        // —————————————————————————————————————————————————————
+        // one consistent set of results, pointing into the segment.
+        struct frame
+        {
+            std::uint64_t seq; // even; grows by 2 with every publish
+            std::size_t count;
+            const double *x, *y;      // preorder
+            const std::byte *records; // count * record_size bytes, 64-byte aligned, or nullptr
+            std::size_t record_size;
+
+            // the record of node v, read in place: Record must be the type
+            // published, so record_size is a multiple of its alignment.
+            template <typename Record>
+            const Record &record(std::size_t v) const
+            {
+                static_assert(alignof(Record) <= details::record_align, "records are only 64-byte aligned");
+                return *reinterpret_cast<const Record *>(records + v * record_size);
+            }
+        };
+
+        // the reading side: maps a publisher's segment read-only.
+        class subscriber
+        {
+        public:
+            explicit subscriber(const char *name)
+            {
+                int fd = shm_open(name, O_RDONLY, 0);
+                if (fd < 0)
+                    return;
+                struct stat st;
+                void *p = MAP_FAILED;
+                if (fstat(fd, &st) == 0 && std::size_t(st.st_size) >= sizeof(details::header))
+                    p = mmap(nullptr, std::size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+                close(fd);
+                if (p == MAP_FAILED)
+                    return;
+                size_ = std::size_t(st.st_size);
+                h_ = static_cast<const details::header *>(p);
+                std::size_t need = 0;
+                if (h_->magic != details::magic || h_->version != details::version ||
+                    !details::segment_size(std::size_t(h_->capacity), std::size_t(h_->record_size), need) || size_ < need)
+                {
+                    munmap(const_cast<details::header *>(h_), size_);
+                    h_ = nullptr;
+                }
+            }
+
+            subscriber(const subscriber &) = delete;
+            subscriber &operator=(const subscriber &) = delete;
+
+            ~subscriber()
+            {
+                if (h_)
+                    munmap(const_cast<details::header *>(h_), size_);
+            }
+
+            // false if there is no such segment, or not one of ours.
+            bool ok() const { return h_ != nullptr; }
+
+            // sequence number of the last complete publish; cheap enough to
+            // poll for changes.
+            std::uint64_t sequence() const
+            {
+                return h_ ? h_->seq.load(std::memory_order_acquire) & ~std::uint64_t(1) : 0;
+            }
+
+            // call use(frame) on a consistent snapshot and return its
+            // sequence number. use reads the segment in place, so it may
+            // run more than once: a run that overlapped a publish may have
+            // seen torn data, and is repeated. it should only read.
+            // returns 0 if no consistent snapshot was had within timeout
+            // (the publisher died mid-publish, or keeps publishing faster
+            // than use runs); whatever use saw must then be dropped. 0 is
+            // also the empty frame before the first publish.
+            template <typename F>
+            std::uint64_t read(const F &use, std::chrono::milliseconds timeout = std::chrono::milliseconds(100)) const
+            {
+                if (!h_)
+                    return 0;
+                auto deadline = std::chrono::steady_clock::now() + timeout;
+                std::size_t cap = std::size_t(h_->capacity), rs = std::size_t(h_->record_size);
+                const double *x = reinterpret_cast<const double *>(h_ + 1);
+                const double *y = x + cap;
+                const std::byte *records = rs ? reinterpret_cast<const std::byte *>(h_) + details::records_offset(cap) : nullptr;
+                for (;;)
+                {
+                    std::uint64_t s = h_->seq.load(std::memory_order_acquire);
+                    if (!(s & 1))
+                    {
+                        std::size_t n = std::size_t(h_->count);
+                        use(frame{s, n < cap ? n : cap, x, y, records, rs});
+                        std::atomic_thread_fence(std::memory_order_acquire);
+                        if (h_->seq.load(std::memory_order_relaxed) == s)
+                            return s;
+                    }
+                    if (std::chrono::steady_clock::now() >= deadline)
+                        return 0;
+                    std::this_thread::yield();
+                }
+            }
+
+        private:
+            std::size_t size_ = 0;
+            const details::header *h_ = nullptr;
+        };
+
+    } // namespace shm
+} // namespace layout
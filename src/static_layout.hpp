@@ -0,0 +1,59 @@
+/**
+ *
+ * compile-time layout for trees whose shape and sizes are known statically
+ * (menus, schema diagrams, ...). the whole tidy layout runs in constant
+ * evaluation and yields a constexpr coordinate table:
+ *
+ *   constexpr auto menu = layout::layout_static(std::array{
+ *       layout::static_node{50, 20, -1},   // 0: root
+ *       layout::static_node{40, 15, 0},    // 1: child of 0
+ *       layout::static_node{40, 15, 0},    // 2: child of 0
+ *   });
+ *   static_assert(menu[1].y == 40);
+ *
+ */
+
+#pragma once
+#include "basic_node.hpp"
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace layout
+{
+
+    // one node of a static tree description. nodes are listed so that every
+    // parent comes before its children; siblings keep their listed order.
+    struct static_node
+    {
+        double w, h;
+        int parent; // index of the parent, -1 for the root (index 0)
+    };
+
+    struct static_coord
+    {
+        double x, y;
+    };
+
+    /// compute x,y for every node of a static tree description.
+    template <std::size_t N>
+    constexpr std::array<static_coord, N> layout_static(const std::array<static_node, N> &tree)
+    {
+        static_assert(N > 0, "a static tree needs at least a root");
+        std::vector<basic_node<double>> nodes(N);
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            nodes[i].w = tree[i].w;
+            nodes[i].h = tree[i].h;
+            if (tree[i].parent >= 0)
+                nodes[tree[i].parent].add_child(&nodes[i]);
+        }
+        layout<basic_node<double>>(&nodes[0]);
+
+        std::array<static_coord, N> out{};
+        for (std::size_t i = 0; i < N; ++i)
+            out[i] = {nodes[i].x, nodes[i].y};
+        return out;
+    }
+
+} // namespace layout
@@ -0,0 +1,520 @@
+/**
+ *
+ * tidy tree layout over a succinct (balanced parentheses) tree encoding.
+ *
+ * the tree shape is stored as a preorder bit sequence ('(' = 1, ')' = 0),
+ * sizes are packed 16-bit integers indexed by preorder id. the layout runs
+ * as two linear scans over the bit sequence, so no per-node parent/children
+ * pointers are ever materialized.
+ *
+ * the output arrays double as working storage: y is written straight into
+ * coords::y from the parent's y (sums of 16-bit sizes and V_SPACING, exact
+ * in float up to 2^24), and prelim lives in coords::x until secondwalk
+ * turns it into x. mod, shift and change and every sum are carried in
+ * double, so x is layout::layout()'s double result up to a few float ulps
+ * of prelim.
+ *
+ * memory per node:
+ *   resident : 2 bits shape + 1 bit leaf index (+ rank directories),
+ *              4 bytes sizes, 8 bytes x/y output
+ *              -> 12.5 bytes once laid out.
+ *   while laying out: 8 bytes for mod
+ *              -> ~20.5 bytes.
+ *   firstwalk scratch (freed before secondwalk):
+ *              left/right threads for leaves (8 bytes per leaf),
+ *              last child for internal nodes (4 bytes per internal node),
+ *              plus the current root-to-node path and its siblings.
+ *   shift/change: summed per child while its parent is open, then kept
+ *              as one 24-byte entry for each child that distribute_extra
+ *              moved, at most one per node and usually a small fraction.
+ *
+ */
+
+#pragma once
+#include "layout.hpp"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <bit>
+
+namespace layout
+{
+    namespace succinct
+    {
+        // —————————————————————————————————————————————————————
+        // plain bitvector with a rank directory (one counter per 512 bits).
+        class bitvector
+        {
+        public:
+            void push_back(bool b)
+            {
+                if ((size_ & 63) == 0)
+                    words_.push_back(0);
+                if (b)
+                    words_.back() |= std::uint64_t(1) << (size_ & 63);
+                ++size_;
+            }
+
+            bool get(std::size_t i) const
+            {
+                return (words_[i >> 6] >> (i & 63)) & 1;
+            }
+
+            std::size_t size() const { return size_; }
+
+            // must be called once after the last push_back.
+            void build_rank()
+            {
+                blocks_.assign(words_.size() / 8 + 1, 0);
+                std::uint64_t acc = 0;
+                for (std::size_t w = 0; w < words_.size(); ++w)
+                {
+                    if ((w & 7) == 0)
+                        blocks_[w >> 3] = acc;
+                    acc += std::popcount(words_[w]);
+                }
+                if ((words_.size() & 7) == 0)
+                    blocks_[words_.size() >> 3] = acc;
+                ones_ = acc;
+            }
+
+            // number of set bits in [0, i).
+            std::size_t rank1(std::size_t i) const
+            {
+                std::size_t w = i >> 6;
+                std::uint64_t r = blocks_[w >> 3];
+                for (std::size_t k = w & ~std::size_t(7); k < w; ++k)
+                    r += std::popcount(words_[k]);
+                if (i & 63)
+                    r += std::popcount(words_[w] & ((std::uint64_t(1) << (i & 63)) - 1));
+                return r;
+            }
+
+            std::size_t ones() const { return ones_; }
+
+            std::size_t memory_bytes() const
+            {
+                return words_.capacity() * sizeof(std::uint64_t) + blocks_.capacity() * sizeof(std::uint64_t);
+            }
+
+        private:
+            std::vector<std::uint64_t> words_;
+            std::vector<std::uint64_t> blocks_;
+            std::size_t size_ = 0, ones_ = 0;
+        };
+        // —————————————————————————————————————————————————————
+
+        // succinct tree: shape as balanced parentheses plus packed sizes.
+        struct tree
+        {
+            bitvector bp;     // preorder '(' = 1, ')' = 0
+            bitvector leaf;   // leaf flag by preorder id
+            std::vector<std::uint16_t> w, h;
+
+            std::size_t size() const { return w.size(); }
+
+            bool is_leaf(std::size_t v) const { return leaf.get(v); }
+
+            std::size_t memory_bytes() const
+            {
+                return bp.memory_bytes() + leaf.memory_bytes() + (w.capacity() + h.capacity()) * sizeof(std::uint16_t);
+            }
+        };
+
+        // builds a tree from a preorder sequence of open()/close() calls.
+        class builder
+        {
+        public:
+            void open(std::uint16_t w, std::uint16_t h)
+            {
+                t_.bp.push_back(true);
+                t_.w.push_back(w);
+                t_.h.push_back(h);
+            }
+
+            void close()
+            {
+                t_.bp.push_back(false);
+            }
+
+            tree finish()
+            {
+                // a node is a leaf iff its '(' is directly followed by ')'.
+                for (std::size_t p = 0; p + 1 < t_.bp.size(); ++p)
+                    if (t_.bp.get(p))
+                        t_.leaf.push_back(!t_.bp.get(p + 1));
+                t_.bp.build_rank();
+                t_.leaf.build_rank();
+                return std::move(t_);
+            }
+
+        private:
+            tree t_;
+        };
+
+        namespace details
+        {
+            // v rounded to the nearest integer, if that fits in 16 bits.
+            template <typename V>
+            bool size16(V v, std::uint16_t &out)
+            {
+                double d = double(v);
+                if (!(d > -0.5 && d < 65535.5))
+                    return false;
+                out = std::uint16_t(d + 0.5);
+                return true;
+            }
+        } // namespace details
+
+        /// encode any TreeNode tree. sizes are rounded to whole units; a
+        /// tree with a size outside [0, 65535] after rounding (or nan) is
+        /// rejected and an empty tree returned. fixed-point nodes are taken
+        /// by their raw integer fields.
+        template <TreeNode Node>
+        tree encode(Node *root)
+        {
+            builder b;
+            std::uint16_t w, h;
+            if (!details::size16(root->w, w) || !details::size16(root->h, h))
+                return {};
+            std::vector<std::pair<Node *, std::size_t>> stack{{root, 0}};
+            b.open(w, h);
+            while (!stack.empty())
+            {
+                auto &[n, next] = stack.back();
+                if (next == n->children.size())
+                {
+                    b.close();
+                    stack.pop_back();
+                    continue;
+                }
+                Node *c = n->children[next++];
+                if (!details::size16(c->w, w) || !details::size16(c->h, h))
+                    return {};
+                b.open(w, h);
+                stack.push_back({c, 0});
+            }
+            return b.finish();
+        }
+
+        // layout output, indexed by preorder id.
+        struct coords
+        {
+            std::vector<float> x, y;
+        };
+
+        // ─── implementation details ────────────────────────────────────────
+        namespace details
+        {
+            constexpr std::uint32_t npos = ~std::uint32_t(0);
+
+            // extreme node of a (forest of) subtree(s) and its sum of modifiers.
+            struct extreme
+            {
+                std::uint32_t l, r;
+                double msl, msr;
+            };
+
+            struct frame
+            {
+                std::uint32_t v;
+                std::size_t kids;   // base offset into the shared children stack
+                std::size_t iyl;    // base offset into the shared IYL stack
+                extreme forest;     // left extreme of children[0], right extreme of the last child
+            };
+
+            struct iyl_entry
+            {
+                double lowY;
+                std::uint32_t index;
+            };
+
+            // shift/change sums of one child, sorted by preorder id before secondwalk.
+            struct spacing
+            {
+                std::uint32_t v;
+                double shift, change;
+            };
+
+            // shift/change of a child of an open node, next to its id in kids_.
+            struct extra
+            {
+                double shift, change;
+            };
+
+            class engine
+            {
+            public:
+                engine(const tree &t, coords &out)
+                    : t_(t), out_(out)
+                {
+                }
+
+                void run()
+                {
+                    std::size_t n = t_.size();
+                    if (n == 0)
+                        return;
+                    std::size_t leaves = t_.leaf.ones();
+                    // prelim is kept in x until secondwalk.
+                    out_.x.assign(n, 0.0f);
+                    out_.y.assign(n, 0.0f);
+                    mod_.assign(n, 0.0);
+                    tl_.assign(leaves, npos);
+                    tr_.assign(leaves, npos);
+                    last_.assign(n - leaves, npos);
+
+                    firstwalk();
+
+                    // threads are only needed while merging contours.
+                    std::vector<std::uint32_t>().swap(tl_);
+                    std::vector<std::uint32_t>().swap(tr_);
+                    std::vector<std::uint32_t>().swap(last_);
+                    std::vector<frame>().swap(stack_);
+                    std::vector<std::uint32_t>().swap(kids_);
+                    std::vector<extra>().swap(extra_);
+                    std::vector<iyl_entry>().swap(iyl_);
+
+                    std::sort(spacing_.begin(), spacing_.end(),
+                              [](const spacing &a, const spacing &b)
+                              { return a.v < b.v; });
+                    secondwalk();
+                    std::vector<double>().swap(mod_);
+                    std::vector<spacing>().swap(spacing_);
+                }
+
+            private:
+                const tree &t_;
+                coords &out_;
+                std::vector<double> mod_;
+                std::vector<std::uint32_t> tl_, tr_, last_;
+                std::vector<frame> stack_;
+                std::vector<std::uint32_t> kids_;
+                std::vector<extra> extra_;
+                std::vector<iyl_entry> iyl_;
+                std::vector<spacing> spacing_;
+
+                float &prelim(std::uint32_t v)
+                {
+                    return out_.x[v];
+                }
+
+                double bottom(std::uint32_t v) const
+                {
+                    return double(out_.y[v]) + t_.h[v];
+                }
+
+                std::uint32_t next_left_contour(std::uint32_t v) const
+                {
+                    return t_.is_leaf(v) ? tl_[t_.leaf.rank1(v)] : v + 1;
+                }
+
+                std::uint32_t next_right_contour(std::uint32_t v) const
+                {
+                    return t_.is_leaf(v) ? tr_[t_.leaf.rank1(v)] : last_[v - t_.leaf.rank1(v)];
+                }
+
+                void firstwalk()
+                {
+                    std::uint32_t next = 0;
+                    for (std::size_t p = 0; p < t_.bp.size(); ++p)
+                    {
+                        if (t_.bp.get(p))
+                        {
+                            std::uint32_t v = next++;
+                            if (stack_.empty())
+                                out_.y[v] = 0;
+                            else
+                            {
+                                std::uint32_t par = stack_.back().v;
+                                out_.y[v] = float(double(out_.y[par]) + t_.h[par] + layout::details::V_SPACING);
+                            }
+                            stack_.push_back({v, kids_.size(), iyl_.size(), {}});
+                        }
+                        else
+                            finish_node();
+                    }
+                }
+
+                // node on top of the stack is complete: position it and merge it into its parent.
+                void finish_node()
+                {
+                    frame f = stack_.back();
+                    stack_.pop_back();
+
+                    extreme e;
+                    std::size_t nk = kids_.size() - f.kids;
+                    if (nk == 0)
+                        e = {f.v, f.v, 0, 0};
+                    else
+                    {
+                        std::uint32_t c0 = kids_[f.kids], cn = kids_.back();
+                        prelim(f.v) = float((prelim(c0) + mod_[c0] + mod_[cn] + prelim(cn) + t_.w[cn]) / 2 - t_.w[f.v] / 2.0);
+                        last_[f.v - t_.leaf.rank1(f.v)] = cn;
+                        e = f.forest;
+                        // one spacing entry per child that distribute_extra moved.
+                        for (std::size_t k = f.kids; k < kids_.size(); ++k)
+                            if (extra_[k].shift != 0 || extra_[k].change != 0)
+                                spacing_.push_back({kids_[k], extra_[k].shift, extra_[k].change});
+                        kids_.resize(f.kids);
+                        extra_.resize(f.kids);
+                        iyl_.resize(f.iyl);
+                    }
+
+                    if (stack_.empty())
+                        return;
+
+                    frame &par = stack_.back();
+                    std::uint32_t i = std::uint32_t(kids_.size() - par.kids);
+                    kids_.push_back(f.v);
+                    extra_.push_back({0, 0});
+                    // the IYL chain tracks how deep each child subtree reaches,
+                    // as layout::details::iyl_extreme picks it.
+                    double minY = bottom(i == 0 ? e.l : e.r);
+                    if (i == 0)
+                        par.forest = e;
+                    else
+                    {
+                        separate(par, i, e);
+                        par.forest.r = e.r;
+                        par.forest.msr = e.msr;
+                    }
+                    update_iyl(par, minY, i);
+                }
+
+                void update_iyl(const frame &par, double miny, std::uint32_t i)
+                {
+                    while (iyl_.size() > par.iyl && miny >= iyl_.back().lowY)
+                        iyl_.pop_back();
+                    iyl_.push_back({miny, i});
+                }
+
+                void separate(frame &par, std::uint32_t i, extreme &child)
+                {
+                    const std::uint32_t *kids = kids_.data() + par.kids;
+                    std::uint32_t sr = kids[i - 1];
+                    double mssr = mod_[sr];
+                    std::uint32_t cl = kids[i];
+                    double mscl = mod_[cl];
+
+                    // cursor walks the IYL stack from its head (top) downwards.
+                    std::size_t cursor = iyl_.size();
+
+                    while (sr != npos && cl != npos)
+                    {
+                        while (cursor > par.iyl && bottom(sr) > iyl_[cursor - 1].lowY)
+                            --cursor;
+
+                        double dist = (mssr + prelim(sr) + t_.w[sr] + layout::details::H_SPACING) - (mscl + prelim(cl));
+                        if (dist > 0)
+                        {
+                            mscl += dist;
+                            std::uint32_t si = cursor > par.iyl ? iyl_[cursor - 1].index : i - 1;
+                            move_subtree(kids, i, si, dist, child);
+                        }
+
+                        double sy = bottom(sr), cy = bottom(cl);
+                        if (sy <= cy)
+                        {
+                            sr = next_right_contour(sr);
+                            if (sr != npos)
+                                mssr += mod_[sr];
+                        }
+                        if (sy >= cy)
+                        {
+                            cl = next_left_contour(cl);
+                            if (cl != npos)
+                                mscl += mod_[cl];
+                        }
+                    }
+
+                    if (sr == npos && cl != npos)
+                    {
+                        // set_left_thread
+                        std::uint32_t li = par.forest.l;
+                        tl_[t_.leaf.rank1(li)] = cl;
+                        double diff = (mscl - mod_[cl]) - par.forest.msl;
+                        mod_[li] += diff;
+                        prelim(li) = float(prelim(li) - diff);
+                        par.forest.l = child.l;
+                        par.forest.msl = child.msl;
+                    }
+                    else if (sr != npos && cl == npos)
+                    {
+                        // set_right_thread
+                        std::uint32_t ri = child.r;
+                        tr_[t_.leaf.rank1(ri)] = sr;
+                        double diff = (mssr - mod_[sr]) - child.msr;
+                        mod_[ri] += diff;
+                        prelim(ri) = float(prelim(ri) - diff);
+                        child.r = par.forest.r;
+                        child.msr = par.forest.msr;
+                    }
+                }
+
+                void move_subtree(const std::uint32_t *kids, std::uint32_t i, std::uint32_t si, double dist, extreme &child)
+                {
+                    mod_[kids[i]] += dist;
+                    child.msl += dist;
+                    child.msr += dist;
+                    // distribute_extra, summed per child until the parent is done.
+                    if (si != i - 1)
+                    {
+                        extra *ex = extra_.data() + (kids - kids_.data());
+                        double nr = i - si;
+                        ex[si + 1].shift += dist / nr;
+                        ex[i].shift -= dist / nr;
+                        ex[i].change -= dist - dist / nr;
+                    }
+                }
+
+                void secondwalk()
+                {
+                    struct walk
+                    {
+                        double modsum, d, modsumdelta;
+                    };
+                    std::vector<walk> stack;
+                    std::size_t sp = 0;
+                    std::uint32_t next = 0;
+                    for (std::size_t p = 0; p < t_.bp.size(); ++p)
+                    {
+                        if (!t_.bp.get(p))
+                        {
+                            stack.pop_back();
+                            continue;
+                        }
+                        std::uint32_t v = next++;
+                        double mod = mod_[v];
+                        if (!stack.empty())
+                        {
+                            // add_child_spacing of the parent, one child at a time.
+                            double shift = 0, change = 0;
+                            if (sp < spacing_.size() && spacing_[sp].v == v)
+                            {
+                                shift = spacing_[sp].shift;
+                                change = spacing_[sp].change;
+                                ++sp;
+                            }
+                            walk &par = stack.back();
+                            par.d += shift;
+                            par.modsumdelta += par.d + change;
+                            mod += par.modsumdelta;
+                        }
+                        double modsum = (stack.empty() ? 0.0 : stack.back().modsum) + mod;
+                        out_.x[v] = float(prelim(v) + modsum);
+                        stack.push_back({modsum, 0, 0});
+                    }
+                }
+            };
+        } // namespace details
+
+        /// compute x,y (indexed by preorder id) for every node of t.
+        inline void layout(const tree &t, coords &out)
+        {
+            details::engine(t, out).run();
+        }
+
+    } // namespace succinct
+} // namespace layout
@@ -0,0 +1,224 @@
+/**
+ *
+ * SVG export of a laid-out tree: a rect per node, a line per edge and,
+ * optionally, a text label per node.
+ *
+ *   layout::layout(root, opt);
+ *   std::FILE *f = std::fopen("tree.svg", "wb");
+ *   layout::svg::write(root, layout::file_sink{f}, opt);
+ *   layout::svg::write(root, layout::file_sink{f}, [](const Node *n) { return n->name; }, opt);
+ *
+ * the document is written in pieces of a few MB as it is produced, edges
+ * first so the node boxes cover their ends. nodes are visited in preorder
+ * ids (metrics.hpp), so blocks of ids can be formatted on several threads
+ * (style::threads) and still come out in order.
+ *
+ * edges join the facing sides of parent and child in the layout's
+ * orientation, and the centres in radial layouts; pass the options the
+ * tree was laid out with.
+ *
+ */
+
+#pragma once
+#include "layout.hpp"
+#include "metrics.hpp"
+#include "text_output.hpp"
+#include <vector>
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <limits>
+#include <string_view>
+
+namespace layout
+{
+    namespace svg
+    {
+        // —————————————————————————————————————————————————————
+        struct style
+        {
+            int decimals = 2; // places kept of every coordinate
+            double margin = 10;
+            // attributes of the groups holding edges, nodes and labels.
+            std::string_view edges = R"(fill="none" stroke="gray")";
+            std::string_view nodes = R"(fill="white" stroke="black")";
+            std::string_view labels = R"(font-family="sans-serif" font-size="10" text-anchor="middle" dominant-baseline="central")";
+            unsigned threads = 1; // formatting threads; 0: one per hardware thread
+        };
+
+        struct no_label
+        {
+            template <typename Node>
+            std::string_view operator()(const Node *) const { return {}; }
+        };
+
+        namespace details
+        {
+            using namespace layout::details;
+
+            struct box
+            {
+                double x, y, w, h;
+            };
+
+            template <TreeNode Node>
+            box bounds(const Node *n)
+            {
+                return {units<Node>(n->x), units<Node>(n->y), units<Node>(n->w), units<Node>(n->h)};
+            }
+
+            struct edge
+            {
+                double x1, y1, x2, y2;
+            };
+
+            // where the edge from p to c starts and ends.
+            inline edge anchors(const box &p, const box &c, const options &opt)
+            {
+                edge e{p.x + p.w / 2, p.y + p.h / 2, c.x + c.w / 2, c.y + c.h / 2};
+                if (opt.radial)
+                    return e;
+                // two_sided trees grow both ways, so look at the boxes.
+                if (opt.orientation == orientation::top_down || opt.orientation == orientation::bottom_up)
+                {
+                    bool down = c.y >= p.y;
+                    e.y1 = down ? p.y + p.h : p.y;
+                    e.y2 = down ? c.y : c.y + c.h;
+                }
+                else
+                {
+                    bool right = c.x >= p.x;
+                    e.x1 = right ? p.x + p.w : p.x;
+                    e.x2 = right ? c.x : c.x + c.w;
+                }
+                return e;
+            }
+        } // namespace details
+
+        /// write the tree at t as an SVG document to out, with label(node)
+        /// as each node's text (nothing for an empty one).
+        template <TreeNode Node, TextSink Out, typename Label>
+            requires std::invocable<const Label &, const Node *> &&
+                     std::convertible_to<std::invoke_result_t<const Label &, const Node *>, std::string_view>
+        void write(Node *t, Out &&out, const Label &label, const options &opt = {}, const style &st = {})
+        {
+            metrics::table<Node> m;
+            metrics::compute(t, m, st.threads);
+            std::size_t n = m.size();
+
+            double x0 = std::numeric_limits<double>::max(), y0 = x0, x1 = -x0, y1 = -x0;
+            for (std::size_t v = 0; v < n; ++v)
+            {
+                details::box b = details::bounds(m.node(v));
+                x0 = std::min(x0, b.x);
+                y0 = std::min(y0, b.y);
+                x1 = std::max(x1, b.x + b.w);
+                y1 = std::max(y1, b.y + b.h);
+            }
+
+            text_buffer head;
+            auto number = [&](text_buffer &b, double v) { b.number(v, st.decimals); };
+            head.put(R"(<svg xmlns="http://www.w3.org/2000/svg" viewBox=")");
+            number(head, x0 - st.margin);
+            head.put(' ');
+            number(head, y0 - st.margin);
+            head.put(' ');
+            number(head, x1 - x0 + 2 * st.margin);
+            head.put(' ');
+            number(head, y1 - y0 + 2 * st.margin);
+            head.put("\">\n<g ");
+            head.put(st.edges);
+            head.put(">\n");
+            out(head.data(), head.size());
+
+            // one path per block, one M..L.. step per edge.
+            layout::details::write_blocks(n, st.threads, [&](text_buffer &b, std::size_t first, std::size_t last)
+                                          {
+                                              first = std::max<std::size_t>(first, 1);
+                                              if (first >= last)
+                                                  return;
+                                              b.put(R"(<path d=")");
+                                              for (std::size_t v = first; v < last; ++v)
+                                              {
+                                                  const Node *c = m.node(v);
+                                                  details::edge e = details::anchors(details::bounds(c->parent), details::bounds(c), opt);
+                                                  b.put('M');
+                                                  number(b, e.x1);
+                                                  b.put(' ');
+                                                  number(b, e.y1);
+                                                  b.put('L');
+                                                  number(b, e.x2);
+                                                  b.put(' ');
+                                                  number(b, e.y2);
+                                              }
+                                              b.put("\"/>\n");
+                                          },
+                                          out);
+
+            head.clear();
+            head.put("</g>\n<g ");
+            head.put(st.nodes);
+            head.put(">\n");
+            out(head.data(), head.size());
+
+            layout::details::write_blocks(n, st.threads, [&](text_buffer &b, std::size_t first, std::size_t last)
+                                          {
+                                              for (std::size_t v = first; v < last; ++v)
+                                              {
+                                                  details::box r = details::bounds(m.node(v));
+                                                  b.put(R"(<rect x=")");
+                                                  number(b, r.x);
+                                                  b.put(R"(" y=")");
+                                                  number(b, r.y);
+                                                  b.put(R"(" width=")");
+                                                  number(b, r.w);
+                                                  b.put(R"(" height=")");
+                                                  number(b, r.h);
+                                                  b.put("\"/>\n");
+                                              }
+                                          },
+                                          out);
+
+            head.clear();
+            head.put("</g>\n");
+            if constexpr (!std::is_same_v<Label, no_label>)
+            {
+                head.put("<g ");
+                head.put(st.labels);
+                head.put(">\n");
+                out(head.data(), head.size());
+                layout::details::write_blocks(n, st.threads, [&](text_buffer &b, std::size_t first, std::size_t last)
+                                              {
+                                                  for (std::size_t v = first; v < last; ++v)
+                                                  {
+                                                      const Node *c = m.node(v);
+                                                      std::string_view s = label(c);
+                                                      if (s.empty())
+                                                          continue;
+                                                      details::box r = details::bounds(c);
+                                                      b.put(R"(<text x=")");
+                                                      number(b, r.x + r.w / 2);
+                                                      b.put(R"(" y=")");
+                                                      number(b, r.y + r.h / 2);
+                                                      b.put("\">");
+                                                      b.escaped(s);
+                                                      b.put("</text>\n");
+                                                  }
+                                              },
+                                              out);
+                head.clear();
+                head.put("</g>\n");
+            }
+            head.put("</svg>\n");
+            out(head.data(), head.size());
+        }
+
+        /// write the tree at t as an SVG document to out, without labels.
+        template <TreeNode Node, TextSink Out>
+        void write(Node *t, Out &&out, const options &opt = {}, const style &st = {})
+        {
+            write(t, out, no_label{}, opt, st);
+        }
+
+    } // namespace svg
+} // namespace layout
@@ -0,0 +1,109 @@
+/**
+ *
+ * pieces shared by the text readers (newick.hpp, json_tree.hpp): a file
+ * mapped into memory, and number parsing.
+ *
+ * mapped_file is POSIX only.
+ *
+ */
+
+#pragma once
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace layout
+{
+    // —————————————————————————————————————————————————————
+    // a file mapped read-only, read front to back. the text (and every
+    // view into it) lives as long as the mapping.
+    class mapped_file
+    {
+    public:
+        explicit mapped_file(const char *path)
+        {
+            int fd = ::open(path, O_RDONLY);
+            if (fd < 0)
+                return;
+            struct stat st;
+            if (fstat(fd, &st) != 0)
+            {
+                ::close(fd);
+                return;
+            }
+            size_ = std::size_t(st.st_size);
+            ok_ = true;
+            if (size_ > 0)
+            {
+                void *p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p == MAP_FAILED)
+                {
+                    ok_ = false;
+                    size_ = 0;
+                }
+                else
+                {
+                    madvise(p, size_, MADV_SEQUENTIAL);
+                    data_ = static_cast<const char *>(p);
+                }
+            }
+            ::close(fd);
+        }
+
+        mapped_file(const mapped_file &) = delete;
+        mapped_file &operator=(const mapped_file &) = delete;
+
+        ~mapped_file()
+        {
+            if (data_)
+                munmap(const_cast<char *>(data_), size_);
+        }
+
+        // false if the file could not be opened or mapped.
+        bool ok() const { return ok_; }
+
+        std::string_view text() const { return {data_, size_}; }
+
+    private:
+        const char *data_ = nullptr;
+        std::size_t size_ = 0;
+        bool ok_ = false;
+    };
+
+    namespace details
+    {
+        // plain decimals of up to 15 digits, which is nearly all numbers
+        // in tree files, are converted as digits / 10^k: both are exact
+        // doubles, so the quotient is the correctly rounded value from_chars
+        // gives. everything else (signs, exponents, long mantissas) goes to
+        // from_chars. false if there is no number at p.
+        inline bool read_number(const char *&p, const char *end, double &out)
+        {
+            static constexpr double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+                                               1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+            const char *q = p;
+            std::uint64_t m = 0;
+            int digits = 0, fraction = 0;
+            for (; q < end && unsigned(*q - '0') < 10; ++q, ++digits)
+                m = m * 10 + unsigned(*q - '0');
+            if (q < end && *q == '.')
+                for (++q; q < end && unsigned(*q - '0') < 10; ++q, ++digits, ++fraction)
+                    m = m * 10 + unsigned(*q - '0');
+            if (digits > 0 && digits <= 15 && (q == end || (*q != 'e' && *q != 'E')))
+            {
+                out = double(m) / pow10[fraction];
+                p = q;
+                return true;
+            }
+            auto [r, ec] = std::from_chars(p, end, out);
+            p = r;
+            return ec == std::errc();
+        }
+    } // namespace details
+} // namespace layout
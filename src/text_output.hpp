@@ -0,0 +1,212 @@
+/**
+ *
+ * pieces shared by the text writers (svg.hpp, json_tree.hpp): a growable
+ * output buffer with fast number formatting, and a driver that formats a
+ * tree in blocks of preorder ids on several threads and passes the text on
+ * in order.
+ *
+ * writers hand their text to a sink, any callable out(const char *, size)
+ * (file_sink and string_sink are ready-made). it is called with large
+ * pieces, so no further buffering is needed.
+ *
+ */
+
+#pragma once
+#include "layout.hpp"
+#include "metrics.hpp"
+#include <vector>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace layout
+{
+    template <typename Out>
+    concept TextSink = requires(Out &out, const char *p, std::size_t n) { out(p, n); };
+
+    struct file_sink
+    {
+        std::FILE *f;
+        void operator()(const char *p, std::size_t n) const { std::fwrite(p, 1, n, f); }
+    };
+
+    struct string_sink
+    {
+        std::string &s;
+        void operator()(const char *p, std::size_t n) const { s.append(p, n); }
+    };
+
+    // —————————————————————————————————————————————————————
+    // appends without per-character bounds checks: reserve() room first.
+    class text_buffer
+    {
+    public:
+        const char *data() const { return buf_.get(); }
+        std::size_t size() const { return size_; }
+        void clear() { size_ = 0; }
+
+        // room for n more characters; write them at the returned pointer,
+        // then advance(n).
+        char *reserve(std::size_t n)
+        {
+            if (cap_ - size_ < n)
+            {
+                std::size_t cap = std::max(cap_ * 2, size_ + n + 4096);
+                std::unique_ptr<char[]> b(new char[cap]);
+                if (size_)
+                    std::memcpy(b.get(), buf_.get(), size_);
+                buf_ = std::move(b);
+                cap_ = cap;
+            }
+            return buf_.get() + size_;
+        }
+
+        void advance(std::size_t n) { size_ += n; }
+
+        void put(char c)
+        {
+            *reserve(1) = c;
+            ++size_;
+        }
+
+        void put(std::string_view s)
+        {
+            std::memcpy(reserve(s.size()), s.data(), s.size());
+            size_ += s.size();
+        }
+
+        // v rounded to `decimals` (0 to 9) places, without trailing zeros:
+        // 212.5, 0, -3.25. values too large for that, and nan or inf, are
+        // written by std::to_chars.
+        void number(double v, int decimals)
+        {
+            static constexpr double scale[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+            static constexpr std::uint64_t iscale[] = {1, 10, 100, 1000, 10000, 100000, 1000000,
+                                                       10000000, 100000000, 1000000000};
+            decimals = std::clamp(decimals, 0, 9);
+            char *p = reserve(32), *first = p;
+            double s = v * scale[decimals];
+            if (!(std::fabs(s) < 9e15))
+            {
+                size_ += std::size_t(std::to_chars(p, p + 32, v).ptr - p);
+                return;
+            }
+            std::int64_t q = std::int64_t(s < 0 ? s - 0.5 : s + 0.5);
+            if (q < 0)
+            {
+                *p++ = '-';
+                q = -q;
+            }
+            std::uint64_t whole = std::uint64_t(q) / iscale[decimals], part = std::uint64_t(q) % iscale[decimals];
+            p = digits(p, whole, 0);
+            if (part)
+            {
+                *p++ = '.';
+                p = digits(p, part, decimals);
+                while (p[-1] == '0')
+                    --p;
+            }
+            size_ += std::size_t(p - first);
+        }
+
+        // s with &, <, >, " and ' written as XML entities.
+        void escaped(std::string_view s)
+        {
+            for (char c : s)
+                switch (c)
+                {
+                case '&':
+                    put("&amp;");
+                    break;
+                case '<':
+                    put("&lt;");
+                    break;
+                case '>':
+                    put("&gt;");
+                    break;
+                case '"':
+                    put("&quot;");
+                    break;
+                case '\'':
+                    put("&apos;");
+                    break;
+                default:
+                    put(c);
+                }
+        }
+
+    private:
+        // decimal digits of v at p, zero-padded to at least `width`.
+        static char *digits(char *p, std::uint64_t v, int width)
+        {
+            static constexpr char pairs[] =
+                "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                "8081828384858687888990919293949596979899";
+            char tmp[24], *e = tmp + sizeof tmp, *b = e;
+            while (v >= 100)
+            {
+                std::memcpy(b -= 2, pairs + 2 * (v % 100), 2);
+                v /= 100;
+            }
+            if (v >= 10)
+                std::memcpy(b -= 2, pairs + 2 * v, 2);
+            else
+                *--b = char('0' + v);
+            while (e - b < width)
+                *--b = '0';
+            std::memcpy(p, b, std::size_t(e - b));
+            return p + (e - b);
+        }
+
+        std::unique_ptr<char[]> buf_;
+        std::size_t size_ = 0, cap_ = 0;
+    };
+
+    namespace details
+    {
+        // a coordinate in drawing units: fixed-point values are scaled back.
+        template <TreeNode Node, typename V>
+        double units(V v)
+        {
+            if constexpr (std::is_integral_v<coord_t<Node>>)
+                return double(v) / double(std::int64_t(1) << fraction_bits<Node>());
+            else
+                return double(v);
+        }
+
+        // emit(buffer, first, last) formats ids [first, last) of n. blocks
+        // of ids are formatted on up to `threads` threads (0: one per
+        // hardware thread), one round of blocks at a time, and written to
+        // out in id order, so at most one round of text is held.
+        template <typename Emit, typename Out>
+        void write_blocks(std::size_t n, unsigned threads, const Emit &emit, Out &out)
+        {
+            constexpr std::size_t block = std::size_t(1) << 15;
+            if (threads == 0)
+                threads = std::thread::hardware_concurrency();
+            threads = std::max(threads, 1u);
+            std::vector<text_buffer> round(threads);
+            for (std::size_t first = 0; first < n; first += threads * block)
+            {
+                std::size_t blocks = std::min<std::size_t>(threads, (n - first + block - 1) / block);
+                metrics::details::run_parallel(blocks, threads, [&](std::size_t k)
+                                               {
+                                                   std::size_t a = first + k * block;
+                                                   round[k].clear();
+                                                   emit(round[k], a, std::min(n, a + block));
+                                               });
+                for (std::size_t k = 0; k < blocks; ++k)
+                    out(round[k].data(), round[k].size());
+            }
+        }
+    } // namespace details
+} // namespace layout
@@ -0,0 +1,25 @@
+/**
+ *
+ * C++20 module interface: `import tidy_tree;`
+ *
+ * the standard headers are pulled into the global module fragment, so the
+ * library headers only contribute their own declarations when they are
+ * included into the exported purview below.
+ *
+ */
+
+module;
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+export module tidy_tree;
+
+export
+{
+#include "layout.hpp"
+#include "basic_node.hpp"
+}
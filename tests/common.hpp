@@ -0,0 +1,195 @@
+/**
+ *
+ * pieces shared by the tests: node types, random tree shapes, an overlap
+ * check and a tiny failure counter.
+ *
+ * every test is a plain executable that prints what went wrong and exits
+ * with 1 if anything did (see CMakeLists.txt, TIDY_TREE_BUILD_TESTS).
+ *
+ */
+
+#pragma once
+#include "basic_node.hpp"
+#include "layout.hpp"
+#include <vector>
+#include <algorithm>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+
+namespace test
+{
+    struct FixedNode
+    {
+        static constexpr int fraction_bits = 8;
+        std::vector<FixedNode *> children;
+        FixedNode *parent = nullptr;
+        std::int64_t x = 0, y = 0, w = 0, h = 0, prelim = 0, mod = 0, shift = 0, change = 0;
+        FixedNode *tl = nullptr, *tr = nullptr, *el = nullptr, *er = nullptr;
+        std::int64_t msel = 0, mser = 0;
+    };
+
+    inline int failures = 0;
+
+    // count a failure and say what it was, printf style.
+    inline void fail(const char *fmt, ...)
+    {
+        ++failures;
+        std::va_list args;
+        va_start(args, fmt);
+        std::vfprintf(stdout, fmt, args);
+        va_end(args);
+        std::fputc('\n', stdout);
+    }
+
+    inline int result(const char *name)
+    {
+        std::printf("%s: %s\n", name, failures ? "FAILED" : "ok");
+        return failures ? 1 : 0;
+    }
+
+    // —————————————————————————————————————————————————————
+    // a tree as parent indices (every parent before its children) and sizes.
+    struct shape
+    {
+        const char *name = "";
+        std::vector<int> parent{};
+        std::vector<double> w{}, h{};
+
+        int add(int p, double w_, double h_)
+        {
+            parent.push_back(p);
+            w.push_back(w_);
+            h.push_back(h_);
+            return int(parent.size()) - 1;
+        }
+    };
+
+    // n nodes, each hung under one of the last few nodes so the trees get
+    // both deep chains and wide fans. sizes are whole units, so depths add
+    // up exactly in floating point too.
+    inline shape make_random(int n, unsigned seed)
+    {
+        std::mt19937 g(seed);
+        shape s{"random"};
+        s.add(-1, 10 + g() % 50, 10 + g() % 50);
+        for (int i = 1; i < n; ++i)
+        {
+            int back = 1 + int(g() % (g() % 4 == 0 ? i : std::min(i, 8)));
+            s.add(i - back, 1 + g() % 60, 1 + g() % 60);
+        }
+        return s;
+    }
+
+    // same as bench/precision.cpp: a wide root over mostly leaves, with an
+    // occasional deep chain ending in a wide node.
+    inline shape make_wide(int fanout, unsigned seed)
+    {
+        std::mt19937 g(seed);
+        shape s{"wide"};
+        s.add(-1, 50, 20);
+        for (int i = 0; i < fanout; ++i)
+        {
+            int p = 0;
+            int depth = g() % 10 == 0 ? 1 + g() % 5 : 0;
+            for (int d = 0; d <= depth; ++d)
+                p = s.add(p, d == depth && depth ? 40 + g() % 200 : 1 + (g() % 1000) / 100.0, 5 + (g() % 1000) / 100.0);
+        }
+        return s;
+    }
+
+    // same as bench/determinism.cpp: a wide root over small random
+    // subtrees, a few of them wide themselves.
+    inline shape make_category(int fanout, unsigned seed)
+    {
+        std::mt19937 g(seed);
+        shape s{"category"};
+        auto size = [&] { return 10 + (g() % 4000) / 100.0; };
+        s.add(-1, 50, 20);
+        for (int i = 0; i < fanout; ++i)
+        {
+            std::vector<int> sub{s.add(0, size(), size())};
+            int n = g() % 1000 == 0 ? 5000 : int(g() % 12);
+            for (int k = 0; k < n; ++k)
+                sub.push_back(s.add(n > 1000 ? sub[0] : sub[g() % sub.size()], size(), size()));
+        }
+        return s;
+    }
+
+    // the nodes of a shape, index i being node i. sizes are multiplied by
+    // scale, e.g. 256 for FixedNode.
+    template <typename Node>
+    std::vector<std::unique_ptr<Node>> build(const shape &s, double scale = 1)
+    {
+        std::vector<std::unique_ptr<Node>> nodes;
+        nodes.reserve(s.parent.size());
+        for (std::size_t i = 0; i < s.parent.size(); ++i)
+        {
+            auto n = std::make_unique<Node>();
+            n->w = decltype(n->w)(s.w[i] * scale);
+            n->h = decltype(n->h)(s.h[i] * scale);
+            if (s.parent[i] >= 0)
+            {
+                n->parent = nodes[std::size_t(s.parent[i])].get();
+                n->parent->children.push_back(n.get());
+            }
+            nodes.push_back(std::move(n));
+        }
+        return nodes;
+    }
+
+    // number of pairs of node boxes that overlap by more than eps on both
+    // axes. boxes that only touch do not count.
+    template <typename Node>
+    std::size_t overlaps(std::vector<const Node *> v, double eps = 1e-6)
+    {
+        std::sort(v.begin(), v.end(), [](const Node *a, const Node *b) { return double(a->x) < double(b->x); });
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < v.size(); ++i)
+        {
+            double right = double(v[i]->x) + double(v[i]->w);
+            for (std::size_t j = i + 1; j < v.size() && double(v[j]->x) < right - eps; ++j)
+                if (double(v[j]->y) < double(v[i]->y) + double(v[i]->h) - eps &&
+                    double(v[i]->y) < double(v[j]->y) + double(v[j]->h) - eps)
+                    ++count;
+        }
+        return count;
+    }
+
+    template <typename Node>
+    std::size_t overlaps(const std::vector<std::unique_ptr<Node>> &nodes, double eps = 1e-6)
+    {
+        std::vector<const Node *> v;
+        for (auto &n : nodes)
+            v.push_back(n.get());
+        return overlaps(std::move(v), eps);
+    }
+
+    // the nodes of the tree at t in preorder.
+    template <typename Node>
+    std::vector<Node *> preorder(Node *t)
+    {
+        std::vector<Node *> order, stack{t};
+        while (!stack.empty())
+        {
+            Node *n = stack.back();
+            stack.pop_back();
+            order.push_back(n);
+            for (std::size_t k = n->children.size(); k-- > 0;)
+                stack.push_back(n->children[k]);
+        }
+        return order;
+    }
+
+    inline const char *name(layout::orientation o)
+    {
+        static const char *names[] = {"top_down", "bottom_up", "left_right", "right_left"};
+        return names[int(o)];
+    }
+
+    inline constexpr layout::orientation orientations[] = {layout::orientation::top_down, layout::orientation::bottom_up,
+                                                           layout::orientation::left_right, layout::orientation::right_left};
+
+} // namespace test
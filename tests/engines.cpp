@@ -0,0 +1,260 @@
+/**
+ *
+ * the other layout engines against layout::layout on random trees: the
+ * sharded, level-of-detail, lazy, succinct and compile-time layouts give
+ * the positions they promise, exactly for fixed-point nodes and up to
+ * rounding for floating point ones.
+ *
+ */
+
+#include "common.hpp"
+#include "layout.hpp"
+#include "lazy_layout.hpp"
+#include "lod_layout.hpp"
+#include "shard_layout.hpp"
+#include "static_layout.hpp"
+#include "succinct_layout.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+constexpr auto menu = layout::layout_static(std::array{
+    layout::static_node{50, 20, -1},
+    layout::static_node{40, 15, 0},
+    layout::static_node{40, 15, 0},
+});
+static_assert(menu[1].y == 40 && menu[2].y == 40 && menu[2].x - menu[1].x == 60);
+
+// a and b (shapes of one test::shape) have the same positions, within tol.
+template <typename A, typename B>
+bool same_positions(const std::vector<A *> &a, const std::vector<B *> &b, double scale, double tol, const char *what)
+{
+    for (std::size_t i = 0; i < a.size(); ++i)
+    {
+        double dx = double(a[i]->x) * scale - double(b[i]->x), dy = double(a[i]->y) * scale - double(b[i]->y);
+        if (std::abs(dx) > tol || std::abs(dy) > tol)
+        {
+            test::fail("%s: node %zu at (%.17g, %.17g), layout::layout has (%.17g, %.17g)", what, i,
+                       double(a[i]->x) * scale, double(a[i]->y) * scale, double(b[i]->x), double(b[i]->y));
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Node>
+std::vector<Node *> raw(const std::vector<std::unique_ptr<Node>> &nodes)
+{
+    std::vector<Node *> v;
+    for (auto &n : nodes)
+        v.push_back(n.get());
+    return v;
+}
+
+template <typename Node>
+void check_shard(const test::shape &s, double scale, double tol)
+{
+    for (layout::orientation o : test::orientations)
+    {
+        layout::options opt;
+        opt.orientation = o;
+        auto full = test::build<Node>(s, scale), sharded = test::build<Node>(s, scale);
+        layout::layout(full[0].get(), opt);
+        layout::shard::layout(sharded[0].get(), {.max_nodes = 64, .processes = 2}, opt);
+        same_positions(raw(sharded), raw(full), 1, tol, "shard");
+    }
+}
+
+// a custom separation policy is handed to layout::layout.
+struct wider_cousins
+{
+    template <typename Node>
+    double operator()(const Node *l, const Node *r) const { return l->parent == r->parent ? 10.0 : 40.0; }
+};
+
+void check_shard_policy(const test::shape &s)
+{
+    using Node = layout::basic_node<double>;
+    auto full = test::build<Node>(s), sharded = test::build<Node>(s);
+    layout::layout(full[0].get(), {}, wider_cousins{});
+    layout::shard::layout(sharded[0].get(), {.max_nodes = 64, .processes = 2}, {}, wider_cousins{});
+    same_positions(raw(sharded), raw(full), 1, 0, "shard policy");
+}
+
+template <typename Node>
+void check_lod(const test::shape &s, double scale, double tol)
+{
+    // depth of every node, to tell the shown ones.
+    std::vector<std::size_t> depth(s.parent.size(), 0);
+    for (std::size_t i = 1; i < s.parent.size(); ++i)
+        depth[i] = depth[std::size_t(s.parent[i])] + 1;
+    for (layout::orientation o : test::orientations)
+    {
+        layout::options opt;
+        opt.orientation = o;
+        auto full = test::build<Node>(s, scale), top = test::build<Node>(s, scale);
+        layout::layout(full[0].get(), opt);
+        layout::lod::cache<Node> ch;
+        for (std::size_t cut : {std::size_t(2), std::size_t(5), SIZE_MAX})
+        {
+            layout::lod::layout(top[0].get(), ch, {.max_depth = cut}, opt);
+            std::vector<Node *> a, b;
+            for (std::size_t i = 0; i < depth.size(); ++i)
+                if (depth[i] <= cut)
+                {
+                    a.push_back(top[i].get());
+                    b.push_back(full[i].get());
+                }
+            same_positions(a, b, 1, tol, "lod");
+        }
+
+        // nodes below the cut are not written at all, not even the
+        // first walk's working fields.
+        auto marked = test::build<Node>(s, scale);
+        for (auto &n : marked)
+            n->x = n->y = n->prelim = n->mod = 7;
+        layout::lod::cache<Node> fresh;
+        layout::lod::layout(marked[0].get(), fresh, {.max_depth = 2}, opt);
+        for (std::size_t i = 0; i < depth.size(); ++i)
+            if (depth[i] > 2)
+            {
+                const Node *n = marked[i].get();
+                if (n->x != 7 || n->y != 7 || n->prelim != 7 || n->mod != 7 || n->tl || n->tr || n->el || n->er)
+                    return test::fail("lod %s: hidden node %zu was written", test::name(o), i);
+            }
+    }
+}
+
+// min_size hides a node's children once even the widest of them would be
+// drawn smaller than it.
+void check_lod_size(const test::shape &s)
+{
+    using Node = layout::basic_node<double>;
+    auto full = test::build<Node>(s);
+    layout::layout(full[0].get());
+    for (double scale : {0.5, 1.0})
+        for (double min_size : {10.0, 30.0})
+        {
+            std::vector<bool> shown(s.parent.size(), true);
+            for (std::size_t i = 1; i < s.parent.size(); ++i)
+            {
+                const Node *p = full[std::size_t(s.parent[i])].get();
+                double widest = 0;
+                for (const Node *c : p->children)
+                    widest = std::max(widest, c->w);
+                shown[i] = shown[std::size_t(s.parent[i])] && widest * scale >= min_size;
+            }
+            auto top = test::build<Node>(s);
+            for (auto &n : top)
+                n->x = n->y = 7;
+            layout::lod::cache<Node> ch;
+            layout::lod::layout(top[0].get(), ch, {.scale = scale, .min_size = min_size});
+            std::vector<Node *> a, b;
+            for (std::size_t i = 0; i < shown.size(); ++i)
+                if (shown[i])
+                {
+                    a.push_back(top[i].get());
+                    b.push_back(full[i].get());
+                }
+                else if (top[i]->x != 7 || top[i]->y != 7)
+                    return test::fail("lod min_size %g at scale %g: hidden node %zu was written", min_size, scale, i);
+            if (!same_positions(a, b, 1, 1e-6, "lod min_size"))
+                return;
+        }
+}
+
+// serves a test::shape to the lazy layout, the same size expanded or not.
+struct provider
+{
+    using key_type = int;
+    const test::shape *s;
+    std::vector<std::vector<int>> kids;
+
+    explicit provider(const test::shape &sh) : s(&sh), kids(sh.parent.size())
+    {
+        for (std::size_t i = 1; i < sh.parent.size(); ++i)
+            kids[std::size_t(sh.parent[i])].push_back(int(i));
+    }
+    void children(int k, std::vector<int> &out) const { out = kids[std::size_t(k)]; }
+    layout::lazy::dimensions size(int k, bool) const { return {s->w[std::size_t(k)], s->h[std::size_t(k)]}; }
+};
+
+void check_lazy(const test::shape &s)
+{
+    provider p(s);
+    for (layout::orientation o : test::orientations)
+    {
+        layout::options opt;
+        opt.orientation = o;
+        layout::lazy::tree<provider> lt(p, 0, opt);
+        // expand everything, top-down, then compare by key.
+        std::vector<layout::lazy::tree<provider>::node_type *> open{lt.root()}, by_key(s.parent.size());
+        while (!open.empty())
+        {
+            auto *n = open.back();
+            open.pop_back();
+            by_key[std::size_t(n->key)] = n;
+            lt.expand(n);
+            for (auto *c : n->children)
+                open.push_back(c);
+        }
+        auto full = test::build<layout::basic_node<double>>(s);
+        layout::layout(full[0].get(), opt);
+        same_positions(by_key, raw(full), 1, 1e-6, "lazy");
+
+        // under a collapsed root nothing can be expanded or collapsed;
+        // showing the root again brings back the same layout.
+        if (lt.root()->children.empty() || !lt.collapse(lt.root()))
+            continue;
+        for (auto *n : by_key)
+            if (n != lt.root() && (n->children.empty() ? lt.expand(n) : lt.collapse(n)))
+                return test::fail("lazy %s: node %d changed under a collapsed root", test::name(o), n->key);
+        lt.expand(lt.root());
+        same_positions(by_key, raw(full), 1, 1e-6, "lazy after collapse");
+    }
+}
+
+void check_succinct(const test::shape &s)
+{
+    auto nodes = test::build<layout::basic_node<double>>(s);
+    layout::layout(nodes[0].get());
+    layout::succinct::tree t = layout::succinct::encode(nodes[0].get());
+    layout::succinct::coords c;
+    layout::succinct::layout(t, c);
+    // y is exact; prelim is kept in float, so x is off by a few float ulps
+    // of the drawing's width at most.
+    std::vector<layout::basic_node<double> *> order = test::preorder(nodes[0].get());
+    double extent = 1;
+    for (auto *n : order)
+        extent = std::max(extent, std::abs(n->x) + n->w);
+    for (std::size_t v = 0; v < order.size(); ++v)
+        if (std::abs(c.x[v] - order[v]->x) > 1e-6 * extent || c.y[v] != float(order[v]->y))
+            return test::fail("succinct: node %zu at (%.9g, %.9g), layout::layout has (%.17g, %.17g)", v,
+                              double(c.x[v]), double(c.y[v]), order[v]->x, order[v]->y);
+
+    // sizes that do not fit in 16 bits are refused, not truncated.
+    for (double bad : {65536.0, -1.0})
+    {
+        order.back()->w = bad;
+        if (layout::succinct::encode(nodes[0].get()).size() != 0)
+            return test::fail("succinct: size %g was encoded", bad);
+    }
+}
+
+int main()
+{
+    for (unsigned seed = 1; seed <= 20; ++seed)
+    {
+        test::shape s = test::make_random(1 + int(seed * 173 % 1500), seed);
+        check_shard<test::FixedNode>(s, 256, 0);
+        check_shard<layout::basic_node<double>>(s, 1, 1e-6);
+        check_shard<layout::basic_node<float>>(s, 1, 1e-2);
+        check_shard_policy(s);
+        check_lod<test::FixedNode>(s, 256, 0);
+        check_lod<layout::basic_node<double>>(s, 1, 1e-6);
+        check_lod_size(s);
+        check_lazy(s);
+        check_succinct(s);
+    }
+    return test::result("engines");
+}
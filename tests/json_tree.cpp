@@ -0,0 +1,103 @@
+/**
+ *
+ * json_tree.hpp: a written tree reads back with the same shape and sizes,
+ * and so lays out the same; the writer's output does not depend on the
+ * number of threads; broken text is refused.
+ *
+ */
+
+#include "common.hpp"
+#include "json_tree.hpp"
+#include "layout.hpp"
+#include <cmath>
+#include <deque>
+#include <string>
+
+using Node = layout::basic_node<double>;
+
+struct arena
+{
+    std::deque<Node> nodes;
+    Node *operator()(Node *parent)
+    {
+        Node *n = &nodes.emplace_back();
+        n->parent = parent;
+        return n;
+    }
+};
+
+// compare the trees at a and b node by node, in preorder. sizes went
+// through two decimals, which every size here has, up to rounding.
+bool close(double a, double b)
+{
+    return std::abs(a - b) <= 1e-6;
+}
+
+bool same(const Node *a, const Node *b, const char *what)
+{
+    std::vector<std::pair<const Node *, const Node *>> stack{{a, b}};
+    while (!stack.empty())
+    {
+        auto [p, q] = stack.back();
+        stack.pop_back();
+        if (p->children.size() != q->children.size() || !close(p->w, q->w) || !close(p->h, q->h) ||
+            !close(p->x, q->x) || !close(p->y, q->y))
+        {
+            test::fail("%s: node (%.17g, %.17g, %.17g x %.17g, %zu children) read back as (%.17g, %.17g, %.17g x %.17g, %zu children)", what,
+                       p->x, p->y, p->w, p->h, p->children.size(), q->x, q->y, q->w, q->h, q->children.size());
+            return false;
+        }
+        for (std::size_t i = 0; i < p->children.size(); ++i)
+            stack.push_back({p->children[i], q->children[i]});
+    }
+    return true;
+}
+
+void check(const test::shape &s)
+{
+    auto nodes = test::build<Node>(s);
+    layout::layout(nodes[0].get());
+    std::string text, parallel;
+    layout::json::write(nodes[0].get(), layout::string_sink{text});
+    layout::json::write(nodes[0].get(), layout::string_sink{parallel}, {.decimals = 2, .threads = 4});
+    if (text != parallel)
+        test::fail("%s: the output on 4 threads differs", s.name);
+
+    // two documents in a row, as JSON lines.
+    text += text;
+    arena a;
+    layout::json::reader r(text);
+    for (int k = 0; k < 2; ++k)
+    {
+        Node *root = r.next(a);
+        if (!root)
+            return test::fail("%s: document %d not read back (offset %zu)", s.name, k, r.offset());
+        layout::layout(root);
+        same(nodes[0].get(), root, s.name);
+    }
+    if (r.next(a) || r.failed())
+        test::fail("%s: more than two documents, or an error at the end", s.name);
+}
+
+int main()
+{
+    for (unsigned seed = 1; seed <= 20; ++seed)
+        check(test::make_random(1 + int(seed * 131 % 2000), seed));
+    check(test::make_wide(3000, 1));
+
+    // sizes default to what alloc left, children may be null, other members are skipped.
+    arena a;
+    layout::json::reader r(R"({"name": "r", "h": 4, "w": 3, "children": [{"w": 1.5, "children": null}, {"h": 2e1, "extra": [1, {"x": "]"}]}]})");
+    Node *root = r.next(a);
+    if (!root || root->w != 3 || root->h != 4 || root->children.size() != 2 ||
+        root->children[0]->w != 1.5 || !root->children[0]->children.empty() || root->children[1]->h != 20 || root->children[1]->parent != root)
+        test::fail("hand-written document misread");
+
+    for (const char *bad : {R"({"w": 1, "children": [{"w": 2}})", R"({"w": })", R"([{"w": 1}])", R"({"w": 1,})"})
+    {
+        layout::json::reader rb(bad);
+        if (rb.next(a) || !rb.failed())
+            test::fail("accepted broken document %s", bad);
+    }
+    return test::result("json_tree");
+}
@@ -0,0 +1,268 @@
+/**
+ *
+ * layout::layout on random trees: no two node boxes may overlap, in any
+ * mode and orientation checked below, every child hangs V_SPACING
+ * below its parent, and a radial layout wraps the plain one onto circles.
+ *
+ */
+
+#include "common.hpp"
+#include "layout.hpp"
+#include <algorithm>
+#include <cmath>
+
+// a set of options checked on every tree.
+struct mode
+{
+    const char *name;
+    bool layered = false;
+    bool two_sided = false;
+    bool preview = false;
+};
+
+const mode modes[] = {
+    {"plain"},
+    {"layered", true},
+    {"preview", false, false, true},
+    {"two_sided", false, true},
+    {"two_sided layered", true, true},
+};
+
+template <typename Node>
+void check_modes(const test::shape &s, double scale)
+{
+    auto nodes = test::build<Node>(s, scale);
+    for (layout::orientation o : test::orientations)
+        for (const mode &m : modes)
+        {
+            layout::options opt;
+            opt.orientation = o;
+            opt.layered = m.layered;
+            opt.two_sided = m.two_sided;
+            if (m.preview)
+                layout::preview(nodes[0].get(), opt);
+            else
+                layout::layout(nodes[0].get(), opt);
+            if (std::size_t k = test::overlaps(nodes))
+                test::fail("%s %s %s: %zu overlapping pairs (%zu nodes)", s.name, test::name(o), m.name, k, nodes.size());
+        }
+}
+
+// a child hangs V_SPACING below its parent's far edge.
+template <typename Node>
+void check_depths(const test::shape &s)
+{
+    auto nodes = test::build<Node>(s);
+    layout::layout(nodes[0].get());
+    for (auto &n : nodes)
+        if (n->parent && n->y != n->parent->y + n->parent->h + layout::details::V_SPACING)
+            test::fail("%s: node at y %g below parent at y %g, h %g", s.name, double(n->y), double(n->parent->y), double(n->parent->h));
+}
+
+// radial: each node's centre sits at the angle its breadth centre maps
+// to and at the radius of its depth in the plain layout. the full circle
+// is the tree's breadth plus one sibling gap.
+void check_radial(const test::shape &s)
+{
+    using Node = layout::basic_node<double>;
+    auto plain = test::build<Node>(s), radial = test::build<Node>(s);
+    layout::layout(plain[0].get());
+    layout::layout(radial[0].get(), {.radial = true});
+    double lo = plain[0]->x, hi = plain[0]->x + plain[0]->w;
+    for (auto &n : plain)
+    {
+        lo = std::min(lo, n->x);
+        hi = std::max(hi, n->x + n->w);
+    }
+    double span = hi - lo + layout::details::H_SPACING;
+    for (std::size_t i = 0; i < plain.size(); ++i)
+    {
+        double a = 2 * layout::details::PI * (plain[i]->x + plain[i]->w / 2 - lo) / span, r = plain[i]->y;
+        double x = radial[i]->x + radial[i]->w / 2, y = radial[i]->y + radial[i]->h / 2;
+        if (std::abs(x - r * std::cos(a)) > 1e-6 * (1 + r) || std::abs(y - r * std::sin(a)) > 1e-6 * (1 + r))
+            return test::fail("%s radial: node %zu centred at (%g, %g), expected (%g, %g)", s.name, i, x, y, r * std::cos(a), r * std::sin(a));
+    }
+}
+
+// the IYL chain must hold how deep each sibling subtree reaches, not how
+// deep its root node is. fed the roots' bottoms, firstwalk overlapped two
+// boxes of this tree.
+template <typename Node>
+void check_iyl(double scale)
+{
+    test::shape s{"iyl"};
+    s.add(-1, 46, 52);
+    s.add(0, 7, 34);
+    s.add(0, 16, 4);
+    s.add(2, 52, 48);
+    s.add(2, 29, 4);
+    s.add(0, 45, 51);
+    check_modes<Node>(s, scale);
+}
+
+// two-sided: the root is mirrored like every other node, so each half
+// hangs V_SPACING off its own side of the root.
+void check_two_sided()
+{
+    using Node = layout::basic_node<double>;
+    for (layout::orientation o : test::orientations)
+    {
+        Node root, a, b;
+        root.w = 40;
+        root.h = 50;
+        a.w = b.w = 30;
+        a.h = b.h = 10;
+        root.add_child(&a);
+        root.add_child(&b);
+        layout::options opt;
+        opt.orientation = o;
+        opt.two_sided = true;
+        layout::layout(&root, opt);
+        bool horizontal = o == layout::orientation::left_right || o == layout::orientation::right_left;
+        bool backward = o == layout::orientation::bottom_up || o == layout::orientation::right_left;
+        auto lo = [&](const Node &n) { return horizontal ? n.x : n.y; };
+        auto hi = [&](const Node &n) { return horizontal ? n.x + n.w : n.y + n.h; };
+        // the root's near edge at 0, one child before it and one after,
+        // V_SPACING apart.
+        const Node &before = lo(a) < lo(b) ? a : b, &after = lo(a) < lo(b) ? b : a;
+        if ((backward ? hi(root) : lo(root)) != 0 ||
+            lo(root) - hi(before) != layout::details::V_SPACING || lo(after) - hi(root) != layout::details::V_SPACING)
+            test::fail("two_sided %s: root at %g..%g, children at %g..%g and %g..%g", test::name(o),
+                       lo(root), hi(root), lo(before), hi(before), lo(after), hi(after));
+    }
+}
+
+// every call of a depth-aware policy gets how many levels the deeper of
+// its two nodes is below the siblings being merged, i.e. below the
+// children of their lowest common ancestor.
+struct recorded
+{
+    using Node = layout::basic_node<double>;
+    std::size_t *calls, *wrong;
+
+    static std::size_t depth(const Node *n)
+    {
+        std::size_t d = 0;
+        for (; n->parent; n = n->parent)
+            ++d;
+        return d;
+    }
+
+    double operator()(const Node *l, const Node *r, std::size_t d) const
+    {
+        const Node *a = l, *b = r;
+        std::size_t da = depth(a), db = depth(b);
+        std::size_t deeper = da > db ? da : db;
+        for (; da > db; --da)
+            a = a->parent;
+        for (; db > da; --db)
+            b = b->parent;
+        while (a != b && a->parent != b->parent)
+            a = a->parent, b = b->parent, --da;
+        // a and b are now the two siblings being merged (or, for a forest,
+        // two roots: a common parent of nullptr).
+        ++*calls;
+        *wrong += d != deeper - da;
+        return 10.0 + 15.0 * double(d);
+    }
+};
+
+// a policy that does not take the depth, and the default written out.
+struct two_args
+{
+    template <typename Node>
+    double operator()(const Node *, const Node *) const { return 20; }
+};
+
+struct three_args
+{
+    template <typename Node>
+    double operator()(const Node *, const Node *, std::size_t) const { return 20; }
+};
+
+void check_separation(const test::shape &s)
+{
+    using Node = layout::basic_node<double>;
+    auto nodes = test::build<Node>(s);
+    for (int mode = 0; mode < 4; ++mode)
+    {
+        static const char *modes[] = {"plain", "layered", "two_sided", "forest"};
+        layout::options opt;
+        opt.layered = mode == 1;
+        opt.two_sided = mode == 2;
+        std::size_t calls = 0, wrong = 0;
+        recorded sep{&calls, &wrong};
+        if (mode == 3)
+        {
+            // the root's children as a forest.
+            std::vector<Node *> roots = nodes[0]->children;
+            for (Node *r : roots)
+                r->parent = nullptr;
+            layout::layout_forest(roots.data(), roots.size(), opt, sep);
+            for (Node *r : roots)
+                r->parent = nodes[0].get();
+        }
+        else
+            layout::layout(nodes[0].get(), opt, sep);
+        if (wrong)
+            test::fail("%s %s: %zu of %zu separation calls got the wrong depth", s.name, modes[mode], wrong, calls);
+        if (mode < 3 && test::overlaps(nodes))
+            test::fail("%s %s: overlaps with a depth-dependent separation", s.name, modes[mode]);
+    }
+
+    // the same layout whether or not the policy takes a depth.
+    auto a = test::build<Node>(s), b = test::build<Node>(s), c = test::build<Node>(s);
+    layout::layout(a[0].get());
+    layout::layout(b[0].get(), {}, two_args{});
+    layout::layout(c[0].get(), {}, three_args{});
+    for (std::size_t i = 0; i < a.size(); ++i)
+        if (a[i]->x != b[i]->x || a[i]->x != c[i]->x)
+            return test::fail("%s: node %zu at %g, %g and %g with equal policies", s.name, i, a[i]->x, b[i]->x, c[i]->x);
+}
+
+// a forest: the root's children laid out as separate trees side by side,
+// every root at depth 0 and no boxes overlapping.
+template <typename Node>
+void check_forest(const test::shape &s, double scale)
+{
+    auto nodes = test::build<Node>(s, scale);
+    std::vector<Node *> roots = nodes[0]->children;
+    for (Node *r : roots)
+        r->parent = nullptr;
+    for (layout::orientation o : test::orientations)
+    {
+        layout::options opt;
+        opt.orientation = o;
+        layout::layout_forest(roots.data(), roots.size(), opt);
+        std::vector<const Node *> v;
+        for (std::size_t i = 1; i < nodes.size(); ++i)
+            v.push_back(nodes[i].get());
+        if (std::size_t k = test::overlaps(std::move(v)))
+            test::fail("%s %s forest: %zu overlapping pairs", s.name, test::name(o), k);
+        if (o == layout::orientation::top_down)
+            for (Node *r : roots)
+                if (r->y != 0)
+                    test::fail("%s forest: a root at y %g", s.name, double(r->y));
+    }
+}
+
+int main()
+{
+    check_two_sided();
+    check_iyl<layout::basic_node<double>>(1);
+    check_iyl<test::FixedNode>(256);
+
+    for (unsigned seed = 1; seed <= 40; ++seed)
+    {
+        test::shape s = test::make_random(20 + int(seed * 37 % 400), seed);
+        check_modes<layout::basic_node<double>>(s, 1);
+        check_modes<layout::basic_node<float>>(s, 1);
+        check_modes<test::FixedNode>(s, 256);
+        check_depths<layout::basic_node<double>>(s);
+        check_radial(s);
+        check_forest<layout::basic_node<double>>(s, 1);
+        check_forest<test::FixedNode>(s, 256);
+        check_separation(s);
+    }
+    return test::result("layout");
+}
@@ -0,0 +1,67 @@
+/**
+ *
+ * metrics.hpp: compute() gives every node its preorder id, size, height,
+ * depth and leaf count, on one thread or several, for random trees and
+ * for a wide root whose children are grouped into parts.
+ *
+ */
+
+#include "common.hpp"
+#include "metrics.hpp"
+#include <unordered_map>
+
+using Node = layout::basic_node<double>;
+
+// the metrics of every node by its index in nodes, the slow way.
+std::vector<layout::metrics::subtree> expected(const test::shape &s)
+{
+    std::vector<layout::metrics::subtree> m(s.parent.size(), {1, 0, 0, 1});
+    for (std::size_t i = 1; i < s.parent.size(); ++i)
+    {
+        m[i].depth = m[std::size_t(s.parent[i])].depth + 1;
+        m[std::size_t(s.parent[i])].leaves = 0;
+    }
+    // every parent comes before its children, so backwards is bottom-up.
+    for (std::size_t i = s.parent.size(); i-- > 1;)
+    {
+        auto &p = m[std::size_t(s.parent[i])];
+        p.size += m[i].size;
+        p.height = std::max(p.height, m[i].height + 1);
+        p.leaves += m[i].leaves;
+    }
+    return m;
+}
+
+void check(const test::shape &s)
+{
+    auto nodes = test::build<Node>(s);
+    std::vector<layout::metrics::subtree> want = expected(s);
+    std::vector<Node *> order = test::preorder(nodes[0].get());
+    std::unordered_map<const Node *, std::size_t> index;
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+        index[nodes[i].get()] = i;
+    for (unsigned threads : {1u, 3u, 8u})
+    {
+        layout::metrics::table<Node> m;
+        layout::metrics::compute(nodes[0].get(), m, threads);
+        if (m.size() != nodes.size())
+            return test::fail("%s, %u threads: %zu nodes in the table of %zu", s.name, threads, m.size(), nodes.size());
+        for (std::size_t v = 0; v < order.size(); ++v)
+        {
+            if (m.node(v) != order[v])
+                return test::fail("%s, %u threads: id %zu is not the preorder node", s.name, threads, v);
+            const layout::metrics::subtree &a = m[v], &b = want[index[order[v]]];
+            if (a.size != b.size || a.height != b.height || a.depth != b.depth || a.leaves != b.leaves)
+                return test::fail("%s, %u threads: node %zu has size %u height %u depth %u leaves %u, expected %u %u %u %u", s.name, threads, v,
+                                  a.size, a.height, a.depth, a.leaves, b.size, b.height, b.depth, b.leaves);
+        }
+    }
+}
+
+int main()
+{
+    for (unsigned seed = 1; seed <= 10; ++seed)
+        check(test::make_random(1 + int(seed * 211 % 3000), seed));
+    check(test::make_wide(20000, 1));
+    return test::result("metrics");
+}
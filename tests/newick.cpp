@@ -0,0 +1,145 @@
+/**
+ *
+ * newick.hpp: labels, branch lengths, comments and quoting are read into
+ * the right nodes; several trees per text; broken text is refused; parsed
+ * trees lay out without overlaps.
+ *
+ */
+
+#include "common.hpp"
+#include "layout.hpp"
+#include "newick.hpp"
+#include <string>
+#include <string_view>
+
+using tree = layout::newick::tree<>;
+
+std::vector<const tree::node_type *> nodes(tree &t)
+{
+    std::vector<const tree::node_type *> v;
+    for (std::size_t i = 0; i < t.size(); ++i)
+        v.push_back(&t[i]);
+    return v;
+}
+
+void check_small()
+{
+    tree t;
+    if (!layout::newick::parse("((a:1.5,'b c''d':2)inner:0.5 , [note] d)root;", t) || t.size() != 5)
+        return test::fail("small tree not parsed (%zu nodes)", t.size());
+
+    // preorder: root, inner, a, b c'd, d.
+    const char *labels[] = {"root", "inner", "a", "b c''d", "d"};
+    double lengths[] = {0, 0.5, 1.5, 2, 0};
+    std::size_t children[] = {2, 2, 0, 0, 0};
+    int parents[] = {-1, 0, 1, 1, 0};
+    for (std::size_t v = 0; v < 5; ++v)
+    {
+        auto &n = t[v];
+        if (n.label != labels[v] || n.length != lengths[v] || n.children.size() != children[v] ||
+            n.parent != (parents[v] < 0 ? nullptr : &t[std::size_t(parents[v])]))
+            test::fail("node %zu: label '%.*s', length %g, %zu children", v, int(n.label.size()), n.label.data(), n.length, n.children.size());
+        if (n.w != 4 + 7 * double(n.label.size()) || n.h != 16)
+            test::fail("node %zu: size %g x %g from label_size", v, n.w, n.h);
+    }
+    if (t[0].children[0] != &t[1] || t[0].children[1] != &t[4] || t[1].children[1] != &t[3])
+        test::fail("children point at the wrong nodes");
+
+    // a size callable gets the preorder index.
+    auto by_index = [](std::string_view, std::size_t v) { return layout::newick::node_size{double(v + 1), 10}; };
+    if (!layout::newick::parse("(a,(b,c));", t, by_index) || t[3].w != 4 || t[4].w != 5)
+        test::fail("size callable not used");
+}
+
+void check_stream()
+{
+    // several trees, one of them a single node, the last without its ';'.
+    std::string text = "(a,b)c;\n x;\n[only a comment] ((a,b),(c,(d,e)f)g)h";
+    layout::newick::reader r(text);
+    tree t;
+    std::size_t sizes[] = {3, 1, 9}, k = 0;
+    while (r.next(t))
+    {
+        if (k < 3 && t.size() != sizes[k])
+            test::fail("tree %zu has %zu nodes", k, t.size());
+        ++k;
+    }
+    if (k != 3 || r.failed())
+        test::fail("read %zu trees of 3%s", k, r.failed() ? ", then failed" : "");
+
+    // the pipeline delivers the same trees, laid out.
+    std::size_t delivered = 0;
+    bool ok = layout::newick::pipeline(text, {}, [&](tree &u)
+                                       {
+                                           if (u.size() != sizes[delivered++ % 3] || test::overlaps(nodes(u)))
+                                               test::fail("pipeline tree %zu wrong", delivered - 1); });
+    if (!ok || delivered != 3)
+        test::fail("pipeline delivered %zu trees of 3", delivered);
+
+    for (const char *bad : {"((a,b);", "(a,b));", "(a,b)c:;", "('a,b);", "a,b;"})
+    {
+        layout::newick::reader rb(bad);
+        if (rb.next(t) || !rb.failed())
+            test::fail("accepted broken text %s", bad);
+    }
+}
+
+// a random tree written as Newick parses back to the same shape and lays
+// out without overlaps.
+void check_random(unsigned seed)
+{
+    test::shape s = test::make_random(1 + int(seed * 211 % 3000), seed);
+    std::vector<std::vector<int>> kids(s.parent.size());
+    for (std::size_t i = 1; i < s.parent.size(); ++i)
+        kids[std::size_t(s.parent[i])].push_back(int(i));
+    std::string text;
+    std::vector<std::pair<int, std::size_t>> stack{{0, 0}};
+    while (!stack.empty())
+    {
+        auto &[v, next] = stack.back();
+        if (next == 0 && !kids[std::size_t(v)].empty())
+            text += '(';
+        if (next < kids[std::size_t(v)].size())
+        {
+            if (next)
+                text += ',';
+            int c = kids[std::size_t(v)][next++];
+            stack.push_back({c, 0});
+            continue;
+        }
+        if (!kids[std::size_t(v)].empty())
+            text += ')';
+        text += "n" + std::to_string(v) + ":1";
+        stack.pop_back();
+    }
+    text += ';';
+
+    tree t;
+    if (!layout::newick::parse(text, t) || t.size() != s.parent.size())
+        return test::fail("random tree %u not parsed", seed);
+    // preorder ids again, to compare child counts.
+    std::vector<int> order, todo{0};
+    while (!todo.empty())
+    {
+        int v = todo.back();
+        todo.pop_back();
+        order.push_back(v);
+        for (auto it = kids[std::size_t(v)].rbegin(); it != kids[std::size_t(v)].rend(); ++it)
+            todo.push_back(*it);
+    }
+    for (std::size_t v = 0; v < t.size(); ++v)
+        if (t[v].children.size() != kids[std::size_t(order[v])].size() || t[v].label != "n" + std::to_string(order[v]))
+            return test::fail("random tree %u: node %zu misread", seed, v);
+    layout::layout(t.root());
+    if (std::size_t k = test::overlaps(nodes(t)))
+        test::fail("random tree %u: %zu overlapping pairs", seed, k);
+}
+
+int main()
+{
+    check_small();
+    check_stream();
+    for (unsigned seed = 1; seed <= 20; ++seed)
+        check_random(seed);
+    return test::result("newick");
+}
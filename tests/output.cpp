@@ -0,0 +1,194 @@
+/**
+ *
+ * the exporters on a laid-out random tree: SVG has a rect per node and an
+ * edge per child, Arrow output is framed as the IPC formats require,
+ * shared memory readers see the published positions and service requests
+ * hold a record per node.
+ *
+ */
+
+#include "arrow_ipc.hpp"
+#include "common.hpp"
+#include "layout.hpp"
+#include "service.hpp"
+#include "shm_output.hpp"
+#include "svg.hpp"
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+using Node = layout::basic_node<double>;
+
+std::size_t count(const std::string &text, const char *what)
+{
+    std::size_t n = 0;
+    for (std::size_t at = text.find(what); at != std::string::npos; at = text.find(what, at + 1))
+        ++n;
+    return n;
+}
+
+void check_svg(Node *root, std::size_t n)
+{
+    std::string text, parallel;
+    layout::svg::write(root, layout::string_sink{text});
+    layout::svg::write(root, layout::string_sink{parallel}, {}, {.threads = 3});
+    // edges are M...L segments of paths.
+    if (count(text, "<rect") != n || count(text, "L") != n - 1 || text.rfind("</svg>") == std::string::npos)
+        test::fail("svg: %zu rects and %zu edges for %zu nodes", count(text, "<rect"), count(text, "L"), n);
+    if (text != parallel)
+        test::fail("svg: the output on 3 threads differs");
+}
+
+void check_arrow(Node *root)
+{
+    for (std::size_t rows : {std::size_t(7), std::size_t(1) << 16})
+    {
+        std::string file, stream;
+        layout::arrow::write(root, layout::string_sink{file}, {.batch_rows = rows, .file = true});
+        layout::arrow::write(root, layout::string_sink{stream}, {.batch_rows = rows});
+        static const char eos[8] = {'\xff', '\xff', '\xff', '\xff', 0, 0, 0, 0};
+        if (file.compare(0, 8, std::string("ARROW1\0\0", 8)) != 0 || file.compare(file.size() - 6, 6, "ARROW1") != 0)
+            test::fail("arrow: file not framed by ARROW1 (batches of %zu)", rows);
+        if (stream.size() % 8 != 0 || stream.compare(stream.size() - 8, 8, std::string(eos, 8)) != 0)
+            test::fail("arrow: stream not ended by the end-of-stream marker (batches of %zu)", rows);
+        // the file holds the stream, after its magic and before its footer.
+        if (file.compare(8, stream.size(), stream) != 0)
+            test::fail("arrow: file and stream messages differ (batches of %zu)", rows);
+    }
+}
+
+// a succinct layout gives the same file as a node tree holding its coords.
+void check_arrow_succinct(const test::shape &s)
+{
+    auto nodes = test::build<Node>(s);
+    layout::succinct::tree t = layout::succinct::encode(nodes[0].get());
+    layout::succinct::coords c;
+    layout::succinct::layout(t, c);
+    std::vector<Node *> order = test::preorder(nodes[0].get());
+    for (std::size_t v = 0; v < order.size(); ++v)
+    {
+        order[v]->x = c.x[v];
+        order[v]->y = c.y[v];
+    }
+    for (std::size_t rows : {std::size_t(7), std::size_t(1) << 16})
+    {
+        std::string a, b;
+        layout::arrow::write(nodes[0].get(), layout::string_sink{a}, {.batch_rows = rows, .file = true});
+        if (!layout::arrow::write(t, c, layout::string_sink{b}, {.batch_rows = rows, .file = true}) || a != b)
+            test::fail("arrow: the succinct file differs (batches of %zu)", rows);
+    }
+    c.x.pop_back();
+    std::string none;
+    if (layout::arrow::write(t, c, layout::string_sink{none}) || !none.empty())
+        test::fail("arrow: wrote coords that do not match the tree");
+}
+
+void check_shm(Node *root, std::size_t n)
+{
+    std::string name = "/tidy_tree_test_" + std::to_string(getpid());
+    layout::shm::publisher pub(name.c_str(), n, sizeof(std::uint32_t));
+    if (!pub.ok())
+        return test::fail("shm: no segment %s", name.c_str());
+    std::uint32_t next = 0;
+    if (!pub.publish(root, [&](const Node *) { return next++; }))
+        return test::fail("shm: publish failed");
+    layout::shm::subscriber sub(name.c_str());
+    std::vector<Node *> order = test::preorder(root);
+    std::size_t wrong = 0;
+    std::uint64_t seq = sub.read([&](const layout::shm::frame &f)
+                                 {
+                                     wrong = f.count == n ? 0 : n;
+                                     for (std::size_t v = 0; v < f.count && v < n; ++v)
+                                         wrong += f.x[v] != order[v]->x || f.y[v] != order[v]->y || f.record<std::uint32_t>(v) != v; });
+    if (!sub.ok() || seq != 2 || wrong)
+        test::fail("shm: read sequence %llu, %zu nodes wrong", (unsigned long long)seq, wrong);
+    // a tree larger than the segment is refused and leaves the last results.
+    Node extra;
+    order.back()->add_child(&extra);
+    if (pub.publish(root) || sub.sequence() != 2)
+        test::fail("shm: publishing %zu nodes into room for %zu", n + 1, n);
+    order.back()->children.clear();
+
+    // records start aligned, whatever the capacity.
+    std::string odd = name + "_odd";
+    Node leaf;
+    layout::shm::publisher aligned(odd.c_str(), 3, sizeof(double));
+    if (!aligned.publish(&leaf, [](const Node *n) { return n->w; }))
+        test::fail("shm: no segment %s", odd.c_str());
+    layout::shm::subscriber aligned_sub(odd.c_str());
+    const std::byte *records = nullptr;
+    aligned_sub.read([&](const layout::shm::frame &f) { records = f.records; });
+    if (reinterpret_cast<std::uintptr_t>(records) % 64 != 0)
+        test::fail("shm: records at %p", static_cast<const void *>(records));
+
+    // a segment whose size overflows is refused, and leaves no name behind.
+    std::string huge = name + "_huge";
+    layout::shm::publisher too_big(huge.c_str(), SIZE_MAX / 8, 8);
+    layout::shm::subscriber huge_sub(huge.c_str());
+    if (too_big.ok() || huge_sub.ok())
+        test::fail("shm: a segment of %zu nodes was created", SIZE_MAX / 8);
+
+    // the name is taken: a second publisher does not take it over.
+    layout::shm::publisher other(name.c_str(), n);
+    if (other.ok())
+        test::fail("shm: a second publisher opened %s", name.c_str());
+
+    // a publisher that died mid-publish leaves the counter odd; readers
+    // give up instead of spinning.
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    void *p = fd < 0 ? MAP_FAILED : mmap(nullptr, sizeof(layout::shm::details::header), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (fd >= 0)
+        close(fd);
+    if (p == MAP_FAILED)
+        return test::fail("shm: cannot map %s", name.c_str());
+    auto *h = static_cast<layout::shm::details::header *>(p);
+    h->seq.store(3);
+    if (sub.read([](const layout::shm::frame &) {}, std::chrono::milliseconds(10)) != 0)
+        test::fail("shm: read a frame while a publish was in progress");
+    h->seq.store(2);
+    munmap(p, sizeof(layout::shm::details::header));
+}
+
+void check_service(Node *root, std::size_t n)
+{
+    std::vector<char> req;
+    layout::service::encode(root, {.orientation = layout::orientation::left_right}, req);
+    layout::service::request_header h;
+    std::memcpy(&h, req.data(), sizeof h);
+    if (req.size() != sizeof h + n * sizeof(layout::service::node_record) || h.count != n || h.orientation != 2)
+        test::fail("service: request of %zu bytes for %zu nodes", req.size(), n);
+}
+
+// a chain is decoded up to max_depth and refused one level below.
+void check_service_depth()
+{
+    for (std::uint32_t depth : {layout::service::max_depth, layout::service::max_depth + 1})
+    {
+        std::vector<layout::service::node_record> chain(depth + 1, {10, 10, 1});
+        chain.back().children = 0;
+        layout::service::request_header h;
+        h.count = std::uint32_t(chain.size());
+        std::vector<Node> nodes;
+        layout::options opt;
+        bool decoded = layout::service::decode(h, chain.data(), nodes, opt) != nullptr;
+        if (decoded != (depth <= layout::service::max_depth))
+            test::fail("service: a chain of depth %u was %s", depth, decoded ? "decoded" : "refused");
+    }
+}
+
+int main()
+{
+    for (unsigned seed = 1; seed <= 5; ++seed)
+    {
+        test::shape s = test::make_random(2 + int(seed * 389 % 3000), seed);
+        auto nodes = test::build<Node>(s);
+        layout::layout(nodes[0].get());
+        check_svg(nodes[0].get(), nodes.size());
+        check_arrow(nodes[0].get());
+        check_arrow_succinct(s);
+        check_shm(nodes[0].get(), nodes.size());
+        check_service(nodes[0].get(), nodes.size());
+    }
+    check_service_depth();
+    return test::result("output");
+}
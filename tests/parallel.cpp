@@ -0,0 +1,115 @@
+/**
+ *
+ * parallel_layout.hpp: parallel::verify finds no difference from the
+ * sequential layout on the determinism benchmark's trees (see
+ * bench/determinism.cpp) and on wide nodes nested in wide nodes, for
+ * double, float and fixed-point nodes, in every orientation and radially.
+ * merge::reordered stays within rounding of it and does not overlap.
+ *
+ */
+
+#include "common.hpp"
+#include "parallel_layout.hpp"
+#include <algorithm>
+#include <cmath>
+
+template <typename Node>
+void check(const test::shape &s, const char *type, double scale)
+{
+    static const char *names[] = {"top_down", "bottom_up", "left_right", "right_left", "radial"};
+    auto nodes = test::build<Node>(s, scale);
+    for (int o = 0; o < 5; ++o)
+    {
+        layout::options opt;
+        if (o < 4)
+            opt.orientation = layout::orientation(o);
+        else
+            opt.radial = true;
+        for (unsigned threads : {2u, 3u})
+        {
+            auto m = layout::parallel::verify(nodes[0].get(), opt, threads);
+            if (m.node)
+                test::fail("%s %s %s, %u threads: node %zu at (%.17g, %.17g), sequential (%.17g, %.17g)", s.name, type, names[o], threads,
+                           m.index, double(m.parallel_x), double(m.parallel_y), double(m.serial_x), double(m.serial_y));
+        }
+    }
+}
+
+// merge::reordered: floating point blocks are joined too, so positions
+// only match up to rounding, relative to the size of the drawing.
+template <typename Node>
+void check_reordered(const test::shape &s, const char *type, double scale, double tol)
+{
+    auto serial = test::build<Node>(s, scale), par = test::build<Node>(s, scale);
+    layout::layout(serial[0].get());
+    layout::parallel::layout(par[0].get(), {}, 3, layout::parallel::merge::reordered);
+    double extent = 1;
+    for (auto &n : serial)
+        extent = std::max({extent, std::abs(double(n->x)), std::abs(double(n->y))});
+    for (std::size_t i = 0; i < serial.size(); ++i)
+        if (std::abs(double(par[i]->x) - double(serial[i]->x)) > tol * extent || par[i]->y != serial[i]->y)
+            return test::fail("%s %s reordered: node %zu at (%.17g, %.17g), sequential (%.17g, %.17g)", s.name, type, i,
+                              double(par[i]->x), double(par[i]->y), double(serial[i]->x), double(serial[i]->y));
+    if (std::size_t k = test::overlaps(par))
+        test::fail("%s %s reordered: %zu overlapping pairs", s.name, type, k);
+}
+
+// wide nodes below wide nodes: every 1000th child of the root is wide,
+// and the first of those has a wide child of its own.
+test::shape make_nested(unsigned seed)
+{
+    std::mt19937 g(seed);
+    test::shape s{"nested"};
+    auto size = [&] { return 1 + (g() % 4000) / 100.0; };
+    auto fan = [&](int p)
+    {
+        for (std::size_t k = 0; k < layout::parallel::wide; ++k)
+            s.add(p, size(), size());
+    };
+    s.add(-1, 50, 20);
+    for (std::size_t i = 0; i < 2 * layout::parallel::wide; ++i)
+    {
+        int c = s.add(0, size(), size());
+        if (i % 1000 == 0)
+        {
+            fan(c);
+            if (i == 0)
+                fan(s.add(c, size(), size()));
+        }
+    }
+    return s;
+}
+
+// a custom separation policy is honoured, by the sequential layout.
+struct wider_cousins
+{
+    template <typename Node>
+    double operator()(const Node *l, const Node *r) const { return l->parent == r->parent ? 10.0 : 40.0; }
+};
+
+void check_policy(const test::shape &s)
+{
+    using Node = layout::basic_node<double>;
+    auto a = test::build<Node>(s), b = test::build<Node>(s);
+    layout::layout(a[0].get(), {}, wider_cousins{});
+    layout::parallel::layout(b[0].get(), {}, 2, wider_cousins{});
+    for (std::size_t i = 0; i < a.size(); ++i)
+        if (a[i]->x != b[i]->x || a[i]->y != b[i]->y)
+            return test::fail("%s policy: node %zu at (%g, %g), sequential (%g, %g)", s.name, i, b[i]->x, b[i]->y, a[i]->x, a[i]->y);
+}
+
+int main()
+{
+    // wide enough for several blocks at the root.
+    for (const test::shape &s : {test::make_wide(3 * layout::parallel::wide, 1), test::make_category(3 * layout::parallel::wide, 2), make_nested(3)})
+    {
+        check<layout::basic_node<double>>(s, "double", 1);
+        check<layout::basic_node<float>>(s, "float", 1);
+        check<test::FixedNode>(s, "fixed", 256);
+        check_policy(s);
+        check_reordered<layout::basic_node<double>>(s, "double", 1, 1e-12);
+        check_reordered<layout::basic_node<float>>(s, "float", 1, 1e-5);
+        check_reordered<test::FixedNode>(s, "fixed", 256, 0);
+    }
+    return test::result("parallel");
+}
@@ -0,0 +1,89 @@
+/**
+ *
+ * snapshot.hpp: encode, decode and restore give back every position and
+ * size within half a quantum (exactly for fixed-point nodes), in every
+ * orientation and radially; damaged snapshots are refused.
+ *
+ */
+
+#include "common.hpp"
+#include "layout.hpp"
+#include "metrics.hpp"
+#include "snapshot.hpp"
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+template <typename Node>
+void check(const test::shape &s, double scale, const layout::options &opt, const char *mode)
+{
+    auto nodes = test::build<Node>(s, scale);
+    layout::layout(nodes[0].get(), opt);
+    constexpr bool fixed = std::is_integral_v<decltype(nodes[0]->x)>;
+    double tol = fixed ? 0 : layout::snapshot::codec{}.quantum / 2;
+
+    std::vector<std::uint8_t> bytes;
+    if (!layout::snapshot::encode(nodes[0].get(), bytes, opt))
+        return test::fail("%s %s: encode failed", s.name, mode);
+
+    // decode: preorder columns in drawing units.
+    layout::snapshot::columns c;
+    if (!layout::snapshot::decode(bytes, c))
+        return test::fail("%s %s: decode failed", s.name, mode);
+    layout::metrics::table<Node> m;
+    layout::metrics::compute(nodes[0].get(), m, 1);
+    if (c.x.size() != m.size())
+        return test::fail("%s %s: decoded %zu nodes of %zu", s.name, mode, c.x.size(), m.size());
+    double unit = double(std::int64_t(1) << layout::details::fraction_bits<Node>());
+    for (std::size_t v = 0; v < m.size(); ++v)
+    {
+        const Node *n = m.node(v);
+        double err = std::max({std::abs(c.x[v] - double(n->x) / unit), std::abs(c.y[v] - double(n->y) / unit),
+                               std::abs(c.w[v] - double(n->w) / unit), std::abs(c.h[v] - double(n->h) / unit)});
+        std::uint32_t parent = n->parent ? std::uint32_t(m.find(n->parent)) : layout::snapshot::columns::no_parent;
+        if (err > tol || c.parent[v] != parent)
+            return test::fail("%s %s: node %zu decoded off by %g, parent %u for %u", s.name, mode, v, err, c.parent[v], parent);
+    }
+
+    // restore into a second tree of the same shape.
+    auto copy = test::build<Node>(s, scale);
+    if (!layout::snapshot::restore(bytes, copy[0].get()))
+        return test::fail("%s %s: restore failed", s.name, mode);
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+        double err = std::max(std::abs(double(copy[i]->x) - double(nodes[i]->x)), std::abs(double(copy[i]->y) - double(nodes[i]->y)));
+        if (err > tol)
+            return test::fail("%s %s: node %zu restored off by %g", s.name, mode, i, err);
+    }
+
+    // a cut snapshot is not one.
+    std::vector<std::uint8_t> cut(bytes.begin(), bytes.begin() + std::ptrdiff_t(bytes.size() / 2));
+    if (layout::snapshot::decode(cut, c) || layout::snapshot::restore(cut, copy[0].get()))
+        test::fail("%s %s: a truncated snapshot was accepted", s.name, mode);
+}
+
+template <typename Node>
+void check_all(const test::shape &s, double scale)
+{
+    for (layout::orientation o : test::orientations)
+    {
+        layout::options opt;
+        opt.orientation = o;
+        check<Node>(s, scale, opt, test::name(o));
+    }
+    layout::options opt;
+    opt.radial = true;
+    check<Node>(s, scale, opt, "radial");
+}
+
+int main()
+{
+    for (unsigned seed = 1; seed <= 20; ++seed)
+    {
+        test::shape s = test::make_random(1 + int(seed * 97 % 700), seed);
+        check_all<layout::basic_node<double>>(s, 1);
+        check_all<layout::basic_node<float>>(s, 1);
+        check_all<test::FixedNode>(s, 256);
+    }
+    return test::result("snapshot");
+}